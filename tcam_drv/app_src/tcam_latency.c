@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * tcam-latency: capture in RT mode and histogram the frame latency.
+ *
+ *   tcam-latency [-c cpu] [-p prio] [-m] [-b] [-r] device...
+ *
+ * Latency is the V4L2 buffer timestamp to frame callback entry. SIGUSR1
+ * dumps the histogram while running, SIGINT / SIGTERM dump and exit.
+ *
+ *   isolcpus=3 nohz_full=3 rcu_nocbs=3 on the kernel command line, then
+ *   sudo tcam-latency -c 3 -p 80 -m -b $TCAMRAW_DEVICE &
+ *   kill -USR1 %1
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tcam_capture.h"
+#include "tcam_loop.h"
+#include "tcam_rt.h"
+
+
+#define		MAX_DEVS	(8)
+
+static TCAM_HIST_T		g_hist;
+static TCAM_LOOP_T*		g_loop;
+
+
+static int on_frame(TCAM_CAPTURE_T* cap, const TCAM_FRAME_T* frame, void* priv)
+{
+	(void)cap;
+
+	if ( NULL == frame )
+		fprintf(stderr, "%s: capture error, removed\n", (const char*)priv);
+
+	return TCAM_LOOP_RELEASE;
+}
+
+/* dump and stop from a normal thread, the RT thread never sees a signal */
+static void* signal_thread(void* arg)
+{
+	sigset_t*	set = arg;
+	int			sig;
+
+	for ( ;; ) {
+		if ( sigwait(set, &sig) )
+			continue;
+
+		tcam_hist_dump(&g_hist, stdout);
+
+		if ( SIGUSR1 != sig ) {
+			tcam_loop_stop(g_loop);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr,
+		"usage: %s [-c cpu] [-p prio] [-m] [-b] [-r] device...\n"
+		"  -c cpu   pin the capture thread (use an isolcpus= core)\n"
+		"  -p prio  SCHED_FIFO priority 1..99\n"
+		"  -m       mlockall and prefault\n"
+		"  -b       busy-poll instead of sleeping in epoll\n"
+		"  -r       raw (UYVY disguised 14 bit) nodes\n",
+		prog);
+}
+
+int main(int argc, char* argv[])
+{
+	TCAM_RT_CFG_T		rt = { .cpu = -1 };
+	TCAM_CAPTURE_CFG_T	cfg;
+	TCAM_CAPTURE_T*		caps[MAX_DEVS] = { NULL };
+	sigset_t			set;
+	pthread_t			sig_tid;
+	int		raw = 0, ndev = 0;
+	int		opt, i, ret = 0;
+
+	while ( (opt = getopt(argc, argv, "c:p:mbrh")) != -1 ) {
+		switch ( opt ) {
+		case 'c':	rt.cpu = atoi(optarg);			break;
+		case 'p':	rt.priority = atoi(optarg);		break;
+		case 'm':	rt.lock_memory = 1;				break;
+		case 'b':	rt.busy_poll = 1;				break;
+		case 'r':	raw = 1;						break;
+		default:
+			usage(argv[0]);
+			return 'h' == opt ? 0 : 1;
+		}
+	}
+
+	if ( optind >= argc || argc - optind > MAX_DEVS ) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	//	signal thread 가 상속하기 전에 모든 thread 에서 막는다
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	tcam_hist_reset(&g_hist);
+
+	ret = tcam_loop_create(&g_loop, 0);
+	if ( ret ) {
+		fprintf(stderr, "tcam_loop_create: %s\n", strerror(-ret));
+		return 1;
+	}
+	tcam_loop_set_latency_hist(g_loop, &g_hist);
+
+	for ( i = optind; i < argc; i++, ndev++ ) {
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.device	= argv[i];
+		cfg.raw		= raw;
+
+		ret = tcam_capture_open(&cfg, &caps[ndev]);
+		if ( 0 == ret )
+			ret = tcam_capture_start(caps[ndev]);
+		if ( 0 == ret )
+			ret = tcam_loop_add_capture(g_loop, caps[ndev], on_frame, NULL, argv[i]);
+		if ( ret ) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(-ret));
+			goto out;
+		}
+	}
+
+	ret = pthread_create(&sig_tid, NULL, signal_thread, &set);
+	if ( ret ) {
+		fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+		goto out;
+	}
+
+	ret = tcam_rt_run(g_loop, &rt);
+	if ( ret ) {
+		fprintf(stderr, "tcam_rt_run: %s\n", strerror(-ret));
+		pthread_cancel(sig_tid);
+	}
+	pthread_join(sig_tid, NULL);
+
+out:
+	//	close() stops streaming
+	for ( i = 0; i < MAX_DEVS; i++ )
+		tcam_capture_close(caps[i]);
+	tcam_loop_destroy(g_loop);
+
+	return ret ? 1 : 0;
+}
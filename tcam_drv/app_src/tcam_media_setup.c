@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * tcam-media-setup: configure the COX LWIR capture pipelines.
+ *
+ *   tcam-media-setup [-R bus] [-V bus] [-o envfile] [-v] [tcam-vdo|tcam-raw]
+ *
+ * Prints TCAM{VDO,RAW}_{DEVICE,SUBDEV}=<path> lines on stdout, and into
+ * envfile when given, so scripts can eval / source the result.
+ *
+ * Exit status: 0 every camera found was set up, 1 a camera was found but
+ * its setup failed (or bad usage), 2 no camera found.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tcam_media.h"
+
+
+typedef struct __tcam_setup_cam__ {
+	const char*		drv;		//	install script name
+	const char*		env;		//	environment prefix
+	int				raw;
+	int				bus;
+	int				enable;
+} TCAM_SETUP_CAM_T;
+
+static TCAM_SETUP_CAM_T		g_cams[] = {
+	{ "tcam-vdo", "TCAMVDO", 0, TCAM_VDO_I2C_BUS, 1 },
+	{ "tcam-raw", "TCAMRAW", 1, TCAM_RAW_I2C_BUS, 1 },
+};
+
+#define		NUM_CAMS	(int)(sizeof(g_cams) / sizeof(g_cams[0]))
+
+
+static long elapsed_us(const struct timespec* t0)
+{
+	struct timespec		t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0->tv_sec) * 1000000L + (t1.tv_nsec - t0->tv_nsec) / 1000;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr,
+		"usage: %s [-R raw_bus] [-V vdo_bus] [-o envfile] [-v] [tcam-vdo|tcam-raw]\n",
+		prog);
+}
+
+int main(int argc, char* argv[])
+{
+	TCAM_PIPE_CFG_T		cfg;
+	TCAM_PIPE_T			pipe;
+	struct timespec		t0;
+	const char*			env_file = NULL;
+	FILE*				env = NULL;
+	int		verbose = 0;
+	int		found = 0;
+	int		failed = 0;
+	int		opt, i, ret;
+
+	while ( (opt = getopt(argc, argv, "R:V:o:vh")) != -1 ) {
+		switch ( opt ) {
+		case 'R':
+			g_cams[1].bus = atoi(optarg);
+			break;
+		case 'V':
+			g_cams[0].bus = atoi(optarg);
+			break;
+		case 'o':
+			env_file = optarg;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ( optind < argc ) {
+		for ( i = 0; i < NUM_CAMS; i++ )
+			g_cams[i].enable = (0 == strcmp(argv[optind], g_cams[i].drv));
+
+		if ( !g_cams[0].enable && !g_cams[1].enable ) {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ( env_file ) {
+		env = fopen(env_file, "w");
+		if ( NULL == env ) {
+			fprintf(stderr, "%s: %s\n", env_file, strerror(errno));
+			return 1;
+		}
+	}
+
+	for ( i = 0; i < NUM_CAMS; i++ ) {
+		const char*		dev = "";
+		const char*		sub = "";
+
+		if ( !g_cams[i].enable )
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+
+		tcam_media_default_cfg(g_cams[i].raw, g_cams[i].bus, &cfg);
+		memset(&pipe, 0, sizeof(pipe));
+
+		ret = tcam_media_setup(&cfg, &pipe);
+		if ( 0 == ret ) {
+			dev = pipe.video_dev;
+			sub = pipe.subdev;
+			found++;
+
+			if ( verbose )
+				fprintf(stderr, "%s: %s %s %s (%ld us)\n", cfg.sensor,
+					pipe.media_dev, dev, sub, elapsed_us(&t0));
+		}
+		else if ( -ENODEV == ret ) {
+			if ( verbose )
+				fprintf(stderr, "%s: not found\n", cfg.sensor);
+		}
+		else {
+			fprintf(stderr, "%s: setup failed (%s)\n", cfg.sensor, strerror(-ret));
+			failed++;
+		}
+
+		//	찾지 못한 카메라도 빈 값으로 출력해 이전 값을 지운다
+		printf("%s_DEVICE=%s\n%s_SUBDEV=%s\n", g_cams[i].env, dev, g_cams[i].env, sub);
+		if ( env )
+			fprintf(env, "export %s_DEVICE=%s\nexport %s_SUBDEV=%s\n",
+				g_cams[i].env, dev, g_cams[i].env, sub);
+	}
+
+	if ( env )
+		fclose(env);
+
+	if ( failed )
+		return 1;
+
+	return found ? 0 : 2;
+}
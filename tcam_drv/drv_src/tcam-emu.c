@@ -0,0 +1,440 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Software model of the COX LWIR FPGA I2C slave.
+ *
+ * Registers an I2C adapter on the bus the camera driver expects
+ * (10 for tcam-raw, 11 for tcam-vdo) and answers the 0x54 register map,
+ * so thermal_probe, the readiness loop and register access can run on a
+ * machine without the camera. No image data is produced.
+ *
+ * Copyright (C).
+ */
+
+#include <linux/delay.h>
+#include <linux/i2c.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/property.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include <media/v4l2-fwnode.h>
+
+
+//#define		TEMUDRV_DBG_MSG
+#define 	TEMU_SLAVE_ID	0x54
+
+#define		TEMU_RAW_BUS			(10)		//	tcam-raw 가 확인하는 버스 번호
+#define		TEMU_VDO_BUS			(11)		//	tcam-vdo 가 확인하는 버스 번호
+#define		TEMU_NUM_REGS			(0x10000)	//	16 bit address space, 16 bit data
+
+//	FPGA registers (see tcam-raw.c / tcam-vdo.c)
+#define		TEMU_REG_RES_W			(0x0200)
+#define		TEMU_REG_RES_H			(0x0201)
+#define		TEMU_REG_FRAME_CNT		(0x0210)
+#define		TEMU_REG_FPA_TEMP		(0x0220)
+#define		TEMU_REG_FPGA_TEMP		(0x0221)
+#define		TEMU_REG_FFC_CNT		(0x0222)
+#define		TEMU_REG_SUPPLY_MV		(0x0223)
+#define		TEMU_REG_SUPPLY_STATUS	(0x0224)
+#define		TEMU_REG_ALARM_CTRL		(0x0340)
+#define		TEMU_REG_ALARM_THRESH	(0x0341)
+#define		TEMU_REG_ALARM_STATUS	(0x0343)
+#define		TEMU_REG_ALARM_PEAK		(0x0344)
+
+#define		TEMU_RO_FIRST			(0x0200)	//	status block, writes ignored
+#define		TEMU_RO_LAST			(0x02ff)
+
+#define		TEMU_FFC_PERIOD_MS		(180000)	//	shutter every 3 minutes
+#define		TEMU_LINK_FREQ			(456000000)	//	same as the overlays
+
+
+typedef struct __thermal_emu_dev_t__ {
+	struct i2c_adapter		adap;
+	struct i2c_client*		client;
+
+	u16*		regs;
+	u16			ptr;				//	auto-increment address pointer
+
+	ktime_t		power_on;			//	adapter add or emu reset
+	ktime_t		freeze_at;
+
+	//	statistics
+	u32			xfer_cnt;
+	u32			nack_cnt;
+	s64			first_res_us;		//	power on -> first RES_W read, -1 if none
+} TEMU_DEV_T;
+
+
+static char *role = "raw";
+module_param(role, charp, 0444);
+MODULE_PARM_DESC(role,
+		 "Emulated camera: raw (bus 10, traw) or vdo (bus 11, tvdo), default raw");
+
+static bool instantiate = true;
+module_param(instantiate, bool, 0444);
+MODULE_PARM_DESC(instantiate,
+		 "Create the traw/tvdo client with a CSI-2 endpoint, default 1");
+
+static unsigned int ready_delay_ms = 300;
+module_param(ready_delay_ms, uint, 0644);
+MODULE_PARM_DESC(ready_delay_ms,
+		 "Time after power on before the slave ACKs, default 300");
+
+static unsigned int nack_pct;
+module_param(nack_pct, uint, 0644);
+MODULE_PARM_DESC(nack_pct,
+		 "Percentage of transfers NACKed after ready (0..100), default 0");
+
+static unsigned int stall_ms;
+module_param(stall_ms, uint, 0644);
+MODULE_PARM_DESC(stall_ms,
+		 "Clock stretch added to every transfer in ms, default 0");
+
+static bool freeze;
+module_param(freeze, bool, 0644);
+MODULE_PARM_DESC(freeze,
+		 "Stop the frame counter to emulate a stalled core, default 0");
+
+static unsigned int fps = 60;
+module_param(fps, uint, 0644);
+MODULE_PARM_DESC(fps, "Core frame rate driving FRAME_CNT, default 60");
+
+static unsigned short res_w = 384;
+module_param(res_w, ushort, 0644);
+MODULE_PARM_DESC(res_w, "Reported active width, default 384");
+
+static unsigned short res_h = 288;
+module_param(res_h, ushort, 0644);
+MODULE_PARM_DESC(res_h, "Reported active height, default 288");
+
+static unsigned short fpa_ck = 30315;
+module_param(fpa_ck, ushort, 0644);
+MODULE_PARM_DESC(fpa_ck, "FPA temperature in 0.01 K, default 30315");
+
+static unsigned short fpga_ck = 31815;
+module_param(fpga_ck, ushort, 0644);
+MODULE_PARM_DESC(fpga_ck, "FPGA die temperature in 0.01 K, default 31815");
+
+static unsigned short supply_mv = 1800;
+module_param(supply_mv, ushort, 0644);
+MODULE_PARM_DESC(supply_mv, "Core supply in mV, default 1800");
+
+static bool supply_fault;
+module_param(supply_fault, bool, 0644);
+MODULE_PARM_DESC(supply_fault, "Clear the power good bit, default 0");
+
+static unsigned short alarm_peak;
+module_param(alarm_peak, ushort, 0644);
+MODULE_PARM_DESC(alarm_peak, "Hottest pixel reported to the comparator, default 0");
+
+
+static TEMU_DEV_T*	g_temu_dev;
+
+static const u32 g_temu_data_lanes[] = { 1, 2 };
+static const u64 g_temu_link_freq[] = { TEMU_LINK_FREQ };
+
+static const struct property_entry g_temu_ep_props[] = {
+	PROPERTY_ENTRY_U32("bus-type", V4L2_FWNODE_BUS_TYPE_CSI2_DPHY),
+	PROPERTY_ENTRY_U32("clock-lanes", 0),
+	PROPERTY_ENTRY_U32_ARRAY("data-lanes", g_temu_data_lanes),
+	PROPERTY_ENTRY_U64_ARRAY("link-frequencies", g_temu_link_freq),
+	{ }
+};
+
+//	sensor -> port@0 -> endpoint@0, same shape as the overlay
+static struct software_node g_temu_nodes[] = {
+	{ .name = "traw" },
+	{ .name = "port@0", .parent = &g_temu_nodes[0] },
+	{ .name = "endpoint@0", .parent = &g_temu_nodes[1], .properties = g_temu_ep_props },
+};
+
+static const struct software_node *g_temu_node_group[] = {
+	&g_temu_nodes[0],
+	&g_temu_nodes[1],
+	&g_temu_nodes[2],
+	NULL
+};
+
+
+static s64 temu_elapsed_us(TEMU_DEV_T* emu)
+{
+	return ktime_us_delta(ktime_get(), emu->power_on);
+}
+
+static bool temu_ready(TEMU_DEV_T* emu)
+{
+	return temu_elapsed_us(emu) >= (s64)ready_delay_ms * 1000;
+}
+
+static u16 temu_frame_cnt(TEMU_DEV_T* emu)
+{
+	ktime_t		now;
+
+	if ( freeze ) {
+		if ( 0 == emu->freeze_at )
+			emu->freeze_at = ktime_get();
+		now = emu->freeze_at;
+	}
+	else {
+		emu->freeze_at = 0;
+		now = ktime_get();
+	}
+
+	return (u16)div_s64(ktime_us_delta(now, emu->power_on) * fps, USEC_PER_SEC);
+}
+
+static u16 temu_read_reg(TEMU_DEV_T* emu, u16 reg)
+{
+	switch ( reg ) {
+	case TEMU_REG_RES_W:
+		if ( emu->first_res_us < 0 )
+			emu->first_res_us = temu_elapsed_us(emu);
+		return res_w;
+	case TEMU_REG_RES_H:
+		return res_h;
+	case TEMU_REG_FRAME_CNT:
+		return temu_frame_cnt(emu);
+	case TEMU_REG_FPA_TEMP:
+		return fpa_ck;
+	case TEMU_REG_FPGA_TEMP:
+		return fpga_ck;
+	case TEMU_REG_FFC_CNT:
+		return (u16)div_s64(temu_elapsed_us(emu), TEMU_FFC_PERIOD_MS * 1000);
+	case TEMU_REG_SUPPLY_MV:
+		return supply_mv;
+	case TEMU_REG_SUPPLY_STATUS:
+		return supply_fault ? 0 : 1;
+	case TEMU_REG_ALARM_STATUS:
+		return (emu->regs[TEMU_REG_ALARM_CTRL] & 0x1) &&
+		       alarm_peak >= emu->regs[TEMU_REG_ALARM_THRESH];
+	case TEMU_REG_ALARM_PEAK:
+		return alarm_peak;
+	default:
+		return emu->regs[reg];
+	}
+}
+
+static void temu_write_reg(TEMU_DEV_T* emu, u16 reg, u16 val)
+{
+	#ifdef TEMUDRV_DBG_MSG
+	printk(KERN_INFO "temu_write_reg %04x = %04x\n", reg, val);
+	#endif
+
+	if ( TEMU_RO_FIRST <= reg && reg <= TEMU_RO_LAST )
+		return;
+
+	emu->regs[reg] = val;
+}
+
+/*
+ * Same protocol as the FPGA: a write sets the 16 bit address pointer and
+ * stores any following big endian words, a read returns words from the
+ * pointer. The pointer auto-increments and survives between messages,
+ * which is what the send-then-recv register reads rely on.
+ */
+static int temu_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	TEMU_DEV_T* emu = i2c_get_adapdata(adap);
+	int		i, j;
+
+	if ( stall_ms )
+		msleep(stall_ms);
+
+	for ( i = 0; i < num; i++ ) {
+		struct i2c_msg *msg = &msgs[i];
+
+		emu->xfer_cnt++;
+
+		if ( TEMU_SLAVE_ID != msg->addr || !temu_ready(emu) ) {
+			emu->nack_cnt++;
+			return -ENXIO;
+		}
+
+		if ( nack_pct && get_random_u32_below(100) < nack_pct ) {
+			emu->nack_cnt++;
+			return -ENXIO;
+		}
+
+		if ( msg->flags & I2C_M_RD ) {
+			for ( j = 0; j < msg->len; j += 2 ) {
+				u16 val = temu_read_reg(emu, emu->ptr++);
+
+				msg->buf[j] = val >> 8;
+				if ( j + 1 < msg->len )
+					msg->buf[j + 1] = val & 0xff;
+			}
+		}
+		else {
+			if ( msg->len < 2 )
+				continue;
+
+			emu->ptr = (msg->buf[0] << 8) | msg->buf[1];
+			for ( j = 2; j + 1 < msg->len; j += 2 )
+				temu_write_reg(emu, emu->ptr++, (msg->buf[j] << 8) | msg->buf[j + 1]);
+		}
+	}
+
+	return num;
+}
+
+static u32 temu_func(struct i2c_adapter *adap)
+{
+	return I2C_FUNC_I2C;
+}
+
+static const struct i2c_algorithm temu_algo = {
+	.master_xfer	= temu_xfer,
+	.functionality	= temu_func,
+};
+
+static ssize_t emu_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	TEMU_DEV_T* emu = i2c_get_adapdata(to_i2c_adapter(dev));
+	ssize_t		len;
+
+	i2c_lock_bus(&emu->adap, I2C_LOCK_SEGMENT);
+	len = sysfs_emit(buf, "xfers %u\nnacks %u\nready_us %lld\n",
+			 emu->xfer_cnt, emu->nack_cnt, emu->first_res_us);
+	i2c_unlock_bus(&emu->adap, I2C_LOCK_SEGMENT);
+
+	return len;
+}
+static DEVICE_ATTR_RO(emu_stats);
+
+//	전원 재인가 흉내: ready 지연, 레지스터, 통계 초기화
+static ssize_t emu_reset_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	TEMU_DEV_T* emu = i2c_get_adapdata(to_i2c_adapter(dev));
+
+	i2c_lock_bus(&emu->adap, I2C_LOCK_SEGMENT);
+	memset(emu->regs, 0, TEMU_NUM_REGS * sizeof(u16));
+	emu->ptr			= 0;
+	emu->power_on		= ktime_get();
+	emu->freeze_at		= 0;
+	emu->xfer_cnt		= 0;
+	emu->nack_cnt		= 0;
+	emu->first_res_us	= -1;
+	i2c_unlock_bus(&emu->adap, I2C_LOCK_SEGMENT);
+
+	return count;
+}
+static DEVICE_ATTR_WO(emu_reset);
+
+static struct attribute *temu_attrs[] = {
+	&dev_attr_emu_stats.attr,
+	&dev_attr_emu_reset.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(temu);
+
+static int __init temu_init(void)
+{
+	struct i2c_board_info info = { };
+	TEMU_DEV_T* emu;
+	int		bus;
+	int		ret;
+
+	if ( sysfs_streq(role, "raw") ) {
+		bus = TEMU_RAW_BUS;
+		g_temu_nodes[0].name = "traw";
+	}
+	else if ( sysfs_streq(role, "vdo") ) {
+		bus = TEMU_VDO_BUS;
+		g_temu_nodes[0].name = "tvdo";
+	}
+	else {
+		pr_err("tcam-emu: invalid role '%s'\n", role);
+		return -EINVAL;
+	}
+
+	emu = kzalloc(sizeof(*emu), GFP_KERNEL);
+	if ( NULL == emu )
+		return -ENOMEM;
+
+	emu->regs = vzalloc(TEMU_NUM_REGS * sizeof(u16));
+	if ( NULL == emu->regs ) {
+		ret = -ENOMEM;
+		goto free_emu;
+	}
+
+	emu->first_res_us	= -1;
+	emu->power_on		= ktime_get();
+
+	emu->adap.owner			= THIS_MODULE;
+	emu->adap.algo			= &temu_algo;
+	emu->adap.nr			= bus;
+	emu->adap.dev.groups	= temu_groups;
+	snprintf(emu->adap.name, sizeof(emu->adap.name), "tcam-emu %s", role);
+	i2c_set_adapdata(&emu->adap, emu);
+
+	//	실제 RP1 I2C 가 이미 같은 번호를 쓰고 있으면 실패한다
+	ret = i2c_add_numbered_adapter(&emu->adap);
+	if ( ret ) {
+		pr_err("tcam-emu: i2c-%d not available (%d)\n", bus, ret);
+		goto free_regs;
+	}
+
+	if ( instantiate ) {
+		ret = software_node_register_node_group(g_temu_node_group);
+		if ( ret )
+			goto del_adapter;
+
+		strscpy(info.type, g_temu_nodes[0].name, sizeof(info.type));
+		info.addr	= TEMU_SLAVE_ID;
+		info.swnode	= &g_temu_nodes[0];
+
+		emu->client = i2c_new_client_device(&emu->adap, &info);
+		if ( IS_ERR(emu->client) ) {
+			ret = PTR_ERR(emu->client);
+			goto unregister_nodes;
+		}
+	}
+
+	g_temu_dev = emu;
+
+	printk(KERN_INFO "tcam-emu: %s on i2c-%d, ready in %u ms\n",
+	       g_temu_nodes[0].name, bus, ready_delay_ms);
+
+	return 0;
+
+unregister_nodes:
+	software_node_unregister_node_group(g_temu_node_group);
+del_adapter:
+	i2c_del_adapter(&emu->adap);
+free_regs:
+	vfree(emu->regs);
+free_emu:
+	kfree(emu);
+
+	return ret;
+}
+
+static void __exit temu_exit(void)
+{
+	TEMU_DEV_T* emu = g_temu_dev;
+
+	if ( emu->client ) {
+		i2c_unregister_device(emu->client);
+		software_node_unregister_node_group(g_temu_node_group);
+	}
+
+	printk(KERN_INFO "tcam-emu: xfers %u, nacks %u, ready %lld us\n",
+	       emu->xfer_cnt, emu->nack_cnt, emu->first_res_us);
+
+	i2c_del_adapter(&emu->adap);
+	vfree(emu->regs);
+	kfree(emu);
+}
+
+module_init(temu_init);
+module_exit(temu_exit);
+
+MODULE_AUTHOR("COX Co.Ltd <csi@coxcamera.com>");
+MODULE_DESCRIPTION("COX LWIR FPGA I2C slave emulator");
+MODULE_LICENSE("GPL v2");
@@ -10,8 +10,10 @@
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/gpio/consumer.h>
+#include <linux/hwmon.h>
 #include <linux/i2c.h>
 #include <linux/init.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/of_graph.h>
@@ -27,12 +29,61 @@
 #include <media/v4l2-image-sizes.h>
 #include <media/v4l2-mediabus.h>
 
+#include "../lib_src/tcam_ctrls.h"
+
 
 #define		TRAWDRV_DBG_MSG
 #define 	TRAW_SLAVE_ID	0x54
 
 #define		DEFAULT_TRAW_WIDTH	(384)
 #define		DEFAULT_TRAW_HEIGHT	(289)
+#define		TRAW_TELEMETRY_LINES	(1)		//	FPGA telemetry after the image
+
+//	FPGA registers
+#define		TRAW_REG_RES_W			(0x0200)	//	active width
+#define		TRAW_REG_RES_H			(0x0201)	//	active height
+#define		TRAW_REG_FRAME_CNT		(0x0210)	//	core frame counter (heartbeat)
+#define		TRAW_REG_FPA_TEMP		(0x0220)	//	FPA temperature (0.01 K)
+#define		TRAW_REG_FPGA_TEMP		(0x0221)	//	FPGA die temperature (0.01 K)
+#define		TRAW_REG_FFC_CNT		(0x0222)	//	shutter / FFC count
+#define		TRAW_REG_SUPPLY_MV		(0x0223)	//	core supply (mV)
+#define		TRAW_REG_SUPPLY_STATUS	(0x0224)	//	[0] power good
+#define		TRAW_REG_CAPTURE_MODE	(0x0300)	//	0: continuous, 1: snapshot
+#define		TRAW_REG_SNAPSHOT_TRIG	(0x0301)	//	write N: emit N frames
+#define		TRAW_REG_FRAME_DECIM	(0x0302)	//	output 1 of N core frames
+#define		TRAW_REG_INT_MODE		(0x0310)	//	0: manual, 1: auto integration
+#define		TRAW_REG_INT_TIME		(0x0311)	//	integration time (us)
+#define		TRAW_REG_TEST_PATTERN	(0x0330)	//	[3:0] pattern, [15] frame stamp
+#define		TRAW_REG_ALARM_CTRL		(0x0340)	//	[0] comparator enable
+#define		TRAW_REG_ALARM_THRESH	(0x0341)	//	raise level (counts)
+#define		TRAW_REG_ALARM_HYST		(0x0342)	//	clear at thresh - hyst
+#define		TRAW_REG_ALARM_STATUS	(0x0343)	//	[0] above threshold
+#define		TRAW_REG_ALARM_PEAK		(0x0344)	//	hottest pixel of last frame
+
+#define		TRAW_CAPTURE_CONTINUOUS	(0)
+#define		TRAW_CAPTURE_SNAPSHOT	(1)
+
+#define		TRAW_SNAPSHOT_MAX_FRAMES	(255)
+#define		TRAW_DECIMATION_MAX			(3600)	//	1 frame / min @60fps
+
+#define		TRAW_FPGA_WAIT_CNT		(300)	//	x 5ms, ready wait at probe
+#define		TRAW_WDT_WAIT_CNT		(100)	//	x 5ms, ready wait on recovery
+#define		TRAW_WDT_MAX_MISS		(2)		//	stalled ticks before recovery
+#define		TRAW_READY_READ_RETRY	(3)		//	reads after the ready edge
+
+#define		TRAW_RESET_ASSERT_US	(1000)	//	reset pulse width
+#define		TRAW_RESET_SETTLE_US	(5000)	//	FPGA I2C slave up after release
+
+#define		TRAW_INT_TIME_MIN_US	(10)
+#define		TRAW_INT_TIME_MAX_US	(65535)	//	16-bit register
+#define		TRAW_INT_TIME_MARGIN_US	(500)	//	FPA readout per frame
+
+#define		TRAW_TEST_PATTERN_STAMP	(0x8000)	//	frame counter in pixel 0
+
+#define		TRAW_REGS_SIZE			(0x10000 * 2)	//	sysfs window, 16-bit regs
+#define		TRAW_BURST_BYTES		(64)			//	bytes per I2C burst
+
+#define		TRAW_COUNTS_MAX			(0x3fff)	//	14-bit radiometric counts
 
 
 typedef enum __thermal_raw_mode_id__ {
@@ -72,6 +123,11 @@ typedef struct __thermal_raw_controls__ {
 		struct v4l2_ctrl*	gain;
 	};
 
+	struct {
+		struct v4l2_ctrl*	auto_exp;
+		struct v4l2_ctrl*	exposure;
+	};
+
 	struct v4l2_ctrl*	pixel_rate;
 	struct v4l2_ctrl*	brightness;
 	struct v4l2_ctrl*	saturation;
@@ -79,6 +135,19 @@ typedef struct __thermal_raw_controls__ {
 	struct v4l2_ctrl*	hue;
 	struct v4l2_ctrl*	hflip;
 	struct v4l2_ctrl*	vflip;
+	struct v4l2_ctrl*	test_pattern;
+
+	struct v4l2_ctrl*	snapshot_mode;
+	struct v4l2_ctrl*	snapshot_count;
+	struct v4l2_ctrl*	snapshot_trigger;
+	struct v4l2_ctrl*	decimation;
+
+	/* FPGA temperature comparator, set as one cluster */
+	struct {
+		struct v4l2_ctrl*	alarm_enable;
+		struct v4l2_ctrl*	alarm_threshold;
+		struct v4l2_ctrl*	alarm_hysteresis;
+	};
 } TRAW_CTRLS_T;
 
 /* regulator supplies */
@@ -110,6 +179,7 @@ typedef struct __thermal_raw_device__ {
 	
 	TRAWMODE_PARAM_T			curr_mode;
 	TRAWMODE_PARAM_T			last_mode;
+	TRAWMODE_PARAM_T			fpga_mode;	//	what the FPGA reports now
 	eTRAWMODE_FPS				curr_fr;
 	struct v4l2_fract			frame_interval;
 
@@ -118,6 +188,36 @@ typedef struct __thermal_raw_device__ {
 	bool						streaming;
 
 	eTRAWMODE_ID				curr_id;
+
+	struct gpio_desc*			reset_gpio;
+
+	/* optional FPGA ready line, replaces I2C polling */
+	struct gpio_desc*			ready_gpio;
+	struct completion			ready_done;
+
+	/* optional FPGA alarm line */
+	struct gpio_desc*			alarm_gpio;
+	int							alarm_irq;
+
+	/* stream stall watchdog */
+	struct delayed_work			wdt_work;
+	u16							wdt_frame_cnt;
+	int							wdt_miss;
+	u32							wdt_recover_cnt;
+
+	/* resolution register monitor */
+	struct delayed_work			src_work;
+	u16							res_reg_w;
+	u16							res_reg_h;
+
+	/* health telemetry, cached for hwmon, polled while powered */
+	struct device*				hwmon_dev;
+	struct delayed_work			hwmon_work;
+	bool						hwmon_valid;
+	long						hwmon_temp[2];	//	m°C: FPA, FPGA
+	long						hwmon_supply_mv;
+	bool						hwmon_supply_fault;
+	u16							hwmon_ffc_cnt;
 } TRAW_DEV_T;
 
 
@@ -136,6 +236,24 @@ static const int	g_traw_fps[] = {
 	[TRAW_60_FPS] = 60,
 };
 
+/*
+ * Output intervals offered by enum_frame_interval: whole multiples of the
+ * core period, the only ones s_frame_interval can set (60, 30, 15 and 7.5 fps).
+ */
+static const int	g_traw_decim[] = { 1, 2, 4, 8 };
+
+/*
+ * FPGA generated patterns. Every pattern frame carries the 16-bit
+ * FPGA frame counter in the first pixel so drops can be counted.
+ */
+static const char * const	g_traw_test_pattern_menu[] = {
+	"Disabled",
+	"Horizontal Ramp",
+	"Vertical Ramp",
+	"Checkerboard",
+	"Frame Counter",
+};
+
 //	COX Pixel Formats
 static const TRAW_PIXFMT_T g_traw_pixfmt[] = {
 	//{ MEDIA_BUS_FMT_Y14_1X14, V4L2_COLORSPACE_RAW, },	
@@ -155,6 +273,21 @@ module_param(virtual_channel, uint, 0444);
 MODULE_PARM_DESC(virtual_channel,
 		 "MIPI CSI-2 virtual channel (0..3), default 0");
 
+static unsigned int wdt_interval_ms = 500;
+module_param(wdt_interval_ms, uint, 0644);
+MODULE_PARM_DESC(wdt_interval_ms,
+		 "Stream stall watchdog period in ms (0 disables), default 500");
+
+static unsigned int src_poll_ms = 1000;
+module_param(src_poll_ms, uint, 0644);
+MODULE_PARM_DESC(src_poll_ms,
+		 "FPGA resolution poll period in ms (0 disables), default 1000");
+
+static unsigned int hwmon_poll_ms = 2000;
+module_param(hwmon_poll_ms, uint, 0644);
+MODULE_PARM_DESC(hwmon_poll_ms,
+		 "Health telemetry refresh period in ms, default 2000");
+
 
 static inline TRAW_DEV_T*	to_traw_dev(struct v4l2_subdev *sd)
 {
@@ -235,6 +368,65 @@ static int thermal_read_reg(TRAW_DEV_T* sensor, u16 reg, u16 *val)
 	return ret;
 }
 
+/*
+ * Burst access, the FPGA auto-increments the register address.
+ * Data stays in bus order (big endian) in both directions.
+ */
+static int thermal_read_burst(TRAW_DEV_T* sensor, u16 reg, u8 *data, int len)
+{
+	struct i2c_client*		client = sensor->i2c_client;
+
+	u8		buf[2] = { reg >> 8, reg & 0xff };
+	int		ret;
+
+
+	ret = i2c_master_send(client, buf, 2);
+	if (ret != 2) {
+		dev_err(&client->dev, "%s: i2c write error, reg: %x\n",
+			__func__, reg);
+		if (ret >= 0)
+			ret = -EINVAL;
+		return ret;
+	}
+
+	ret = i2c_master_recv(client, data, len);
+	if (ret == len) {
+		ret = 0;
+	} else {
+		dev_err(&client->dev, "%s: i2c read error, reg: %x\n",
+				__func__, reg);
+		if (ret >= 0)
+			ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int thermal_write_burst(TRAW_DEV_T* sensor, u16 reg, const u8 *data, int len)
+{
+	struct i2c_client*		client = sensor->i2c_client;
+
+	u8		buf[2 + TRAW_BURST_BYTES];
+	int		ret;
+
+
+	buf[0] = reg >> 8;
+	buf[1] = reg & 0xff;
+	memcpy(&buf[2], data, len);
+
+	ret = i2c_master_send(client, buf, len + 2);
+	if (ret == len + 2) {
+		ret = 0;
+	} else {
+		dev_err(&client->dev, "%s: i2c write error, reg: %x\n",
+				__func__, reg);
+		if (ret >= 0)
+			ret = -EINVAL;
+	}
+
+	return ret;
+}
+
 static int thermal_comapre_param( TRAWMODE_PARAM_T* mode1, TRAWMODE_PARAM_T* mode2 ) 
 {
 	if ( 0 != memcmp(mode1, mode2, sizeof(TRAWMODE_PARAM_T)) ) {
@@ -303,7 +495,7 @@ thermal_find_mode(TRAW_DEV_T* sensor, eTRAWMODE_FPS fr,
 	printk(KERN_INFO "[I] thermal_find_mode (%d:%d:%d)\n", width, height, fr);
 	#endif
 
-	mode = &g_traw_mode_param;
+	mode = &sensor->fpga_mode;
 
 	if ( mode->hact != width || mode->vact != height || fr >= TRAW_NUM_FRAMERATES ) {
 		printk(KERN_INFO "[E] thermal_find_mode\n");
@@ -331,17 +523,180 @@ static u64 thermal_calc_pixel_rate(TRAW_DEV_T* sensor)
 	return rate;
 }
 
+/*
+ * Integration has to fit in the core frame period minus FPA readout.
+ * Decimation does not change it: the core keeps its native rate and the
+ * FPGA only drops frames on the way out.
+ */
+static int thermal_calc_max_integration(TRAW_DEV_T* sensor)
+{
+	int max_us;
+
+	max_us = USEC_PER_SEC / g_traw_fps[sensor->curr_fr] - TRAW_INT_TIME_MARGIN_US;
+
+	return min(max_us, TRAW_INT_TIME_MAX_US);
+}
+
+/*
+ * Take over the mode the FPGA reports, called with sensor->lock held.
+ * A source change seen while streaming stays in fpga_mode until the next
+ * set_fmt, stream on fails with -EPIPE until then.
+ */
+static void thermal_apply_fpga_mode(TRAW_DEV_T* sensor)
+{
+	if ( 0 == thermal_comapre_param(&(sensor->fpga_mode), &(sensor->curr_mode)) ) {
+		return;
+	}
+
+	thermal_copy_param(&(sensor->fpga_mode), &(sensor->curr_mode));
+
+	sensor->fmt.width	= sensor->curr_mode.hact;
+	sensor->fmt.height	= sensor->curr_mode.vact;
+
+	__v4l2_ctrl_s_ctrl_int64(sensor->ctrls.pixel_rate, thermal_calc_pixel_rate(sensor));
+}
+
 static void thermal_reset(TRAW_DEV_T* sensor)
 {
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "thermal_reset\n");
 	#endif
+
+	if ( NULL == sensor->reset_gpio ) {
+		return;
+	}
+
+	/*
+	 * Hold the FPGA in reset for a fixed pulse, then leave it time to
+	 * bring up its I2C slave. Bitstream load and core start-up are
+	 * covered by the ready wait in thermal_detect_fpga().
+	 */
+	gpiod_set_value_cansleep(sensor->reset_gpio, 1);
+	usleep_range(TRAW_RESET_ASSERT_US, TRAW_RESET_ASSERT_US + 500);
+	gpiod_set_value_cansleep(sensor->reset_gpio, 0);
+	usleep_range(TRAW_RESET_SETTLE_US, TRAW_RESET_SETTLE_US + 1000);
+}
+
+static irqreturn_t thermal_ready_irq(int irq, void *dev_id)
+{
+	TRAW_DEV_T* sensor = dev_id;
+
+	complete(&sensor->ready_done);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * Sleep on the ready line edge, the bus is left alone meanwhile.
+ * The completion is re-armed before the level check so an edge
+ * between the two is not lost.
+ */
+static int thermal_wait_ready(TRAW_DEV_T* sensor, unsigned int timeout_ms)
+{
+	reinit_completion(&sensor->ready_done);
+
+	if ( gpiod_get_value_cansleep(sensor->ready_gpio) ) {
+		return 0;
+	}
+
+	if ( !wait_for_completion_timeout(&sensor->ready_done,
+					 msecs_to_jiffies(timeout_ms)) ) {
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/*
+ * Wait until the FPGA answers on I2C and latch its resolution.
+ * Runs at first probe and again after a watchdog reset.
+ */
+static int thermal_detect_fpga(TRAW_DEV_T* sensor, int max_wait)
+{
+	struct device *dev = &sensor->i2c_client->dev;
+	u16			img_w, img_h;
+	int			wait_cnt;
+	int			ret;
+
+	if ( sensor->ready_gpio ) {
+		ret = thermal_wait_ready(sensor, max_wait * 5);
+		if ( ret ) {
+			printk(KERN_INFO ">>>>>>>>> FPGA READY TIMEOUT\n");
+			return ret;
+		}
+
+		//	ready 이후에는 몇 번만 읽는다
+		max_wait = TRAW_READY_READ_RETRY;
+	}
+
+	for ( wait_cnt = 0; wait_cnt < max_wait; wait_cnt++ ) {
+		ret = 0;
+		ret += thermal_read_reg(sensor, TRAW_REG_RES_W, &img_w);
+		ret += thermal_read_reg(sensor, TRAW_REG_RES_H, &img_h);
+
+		if ( 0 == ret ) {
+			printk(KERN_INFO ">>>>>>>>> FPGA READ %d %d\n", img_w, img_h);
+			break;
+		}
+
+		msleep(5);
+	}
+
+	if ( max_wait <= wait_cnt ) {
+		printk(KERN_INFO ">>>>>>>>> FPGA WAIT TIMEOUT\n");
+		return -ETIMEDOUT;
+	}
+
+	//	첫 감지 값만 기준으로 저장, 이후 변경은 thermal_src_work 에서 처리
+	if ( 0 == sensor->res_reg_w ) {
+		sensor->res_reg_w = img_w;
+		sensor->res_reg_h = img_h;
+	}
+
+	//	해상도를 읽어서 V4L2 기본 설정 진행
+	g_res_w = img_w;
+	g_res_h = 289;
+
+	printk(KERN_INFO ">>>>>>>>> FPGA RES (%04d:%04d)\n", g_res_w, g_res_h);
+
+	if ( g_traw_mode_param.hact == g_res_w &&
+		g_traw_mode_param.vact == g_res_h ) {
+		g_traw_id = TRAW_MODE_QVGA_384_289;
+	}
+	else {
+		dev_err(dev, "thermal:invalid resolution (%04d:%04d)\n", g_res_w, g_res_h);
+
+		g_traw_id = TRAW_MODE_QVGA_384_289;
+
+		g_res_w = 384;
+		g_res_h = 289;
+	}
+
+	return 0;
+}
+
+/*
+ * Reset the FPGA, wait for it and replay the control handler.
+ * Called with sensor->lock held.
+ */
+static int thermal_reinit(TRAW_DEV_T* sensor)
+{
+	int ret;
+
+	thermal_reset(sensor);
+
+	ret = thermal_detect_fpga(sensor, TRAW_WDT_WAIT_CNT);
+	if ( ret ) {
+		return ret;
+	}
+
+	return __v4l2_ctrl_handler_setup(&sensor->ctrls.handler);
 }
 
 static int thermal_set_power_on(TRAW_DEV_T* sensor)
 {
 	//struct i2c_client *client = sensor->i2c_client;
-	//int ret;
+	int ret = 0;
 
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "[I] thermal_set_power_on\n");
@@ -351,12 +706,16 @@ static int thermal_set_power_on(TRAW_DEV_T* sensor)
 	printk(KERN_INFO "thermal_set_power_on reset\n");
 	#endif
 
-	thermal_reset(sensor);
+	if ( sensor->reset_gpio ) {
+		thermal_reset(sensor);
+		ret = thermal_detect_fpga(sensor, TRAW_WDT_WAIT_CNT);
+	}
+
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "[O]thermal_set_power_on complete\n");
 	#endif
 	
-	return 0;
+	return ret;
 }
 
 static void thermal_set_power_off(TRAW_DEV_T* sensor)
@@ -370,12 +729,14 @@ static void thermal_set_power_off(TRAW_DEV_T* sensor)
 
 static int thermal_set_power(TRAW_DEV_T* sensor, bool on)
 {
+	int ret = 0;
+
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "thermal_set_power(%x)\n", on);
 	#endif
 
 	if ( on ) {
-		thermal_set_power_on(sensor);
+		ret = thermal_set_power_on(sensor);
 	}
 
 	if (sensor->ep.bus_type == V4L2_MBUS_CSI2_DPHY) {
@@ -384,7 +745,7 @@ static int thermal_set_power(TRAW_DEV_T* sensor, bool on)
 		printk(KERN_INFO "[E] thermal_set_power(%d)\n", sensor->ep.bus_type);
 	}
 
-	return 0;
+	return ret;
 }
 
 /* --------------- Subdev Operations --------------- */
@@ -411,14 +772,22 @@ static int thermal_s_power(struct v4l2_subdev *sd, int on)
 	sensor->power_count += on ? 1 : -1;
 	WARN_ON(sensor->power_count < 0);
 
+	/* telemetry follows the power state, stale values read as -ENODATA */
+	if ( sensor->power_count == 0 ) {
+		sensor->hwmon_valid = false;
+	}
+	else if ( on && sensor->power_count == 1 && sensor->hwmon_dev ) {
+		schedule_delayed_work(&sensor->hwmon_work, 0);
+	}
+
 	mutex_unlock(&sensor->lock);
 
 	if (on && !ret && sensor->power_count == 1) {
 		#ifdef TRAWDRV_DBG_MSG
 		printk(KERN_INFO "thermal_s_power (complete)\n");
 		#endif
-		/* restore controls */
-		//ret = v4l2_ctrl_handler_setup(&sensor->ctrls.handler);
+		/* restore controls, power-up may have reset the FPGA */
+		ret = v4l2_ctrl_handler_setup(&sensor->ctrls.handler);
 	}
 
 	#ifdef TRAWDRV_DBG_MSG
@@ -428,55 +797,6 @@ static int thermal_s_power(struct v4l2_subdev *sd, int on)
 	return ret;
 }
 
-static int thermal_try_frame_interval(TRAW_DEV_T* sensor,
-				     struct v4l2_fract *fi,
-				     u32 width, u32 height)
-{
-	const TRAWMODE_PARAM_T* mode;
-	eTRAWMODE_FPS rate = TRAW_08_FPS;
-	int minfps, maxfps, best_fps, fps;
-	int i;
-
-
-	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "[I] thermal_try_frame_interval (%x)\n", fi->numerator);
-	#endif
-
-	minfps = g_traw_fps[TRAW_08_FPS];
-	maxfps = g_traw_fps[TRAW_60_FPS];
-
-	if (fi->numerator == 0) {
-		fi->denominator = maxfps;
-		fi->numerator = 1;
-		rate = TRAW_60_FPS;
-		goto find_mode;
-	}
-
-	fps = clamp_val(DIV_ROUND_CLOSEST(fi->denominator, fi->numerator), minfps, maxfps);
-
-	best_fps = minfps;
-	for (i = 0; i < ARRAY_SIZE(g_traw_fps); i++) {
-		int curr_fps = g_traw_fps[i];
-
-		if (abs(curr_fps - fps) < abs(best_fps - fps)) {
-			best_fps = curr_fps;
-			rate = i;
-		}
-	}
-
-	fi->numerator = 1;
-	fi->denominator = best_fps;
-
-find_mode:
-	mode = thermal_find_mode(sensor, rate, width, height);
-
-	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "[O] thermal_try_frame_interval (%p %x)\n", mode, rate);
-	#endif
-
-	return mode ? rate : -EINVAL;
-}
-
 static int thermal_get_fmt(struct v4l2_subdev *sd,
 			  struct v4l2_subdev_state *sd_state,
 			  struct v4l2_subdev_format *format)
@@ -504,12 +824,8 @@ static int thermal_get_fmt(struct v4l2_subdev *sd,
 		fmt = &sensor->fmt;
 	}
 
-	fmt->reserved[1] = (sensor->curr_fr == TRAW_60_FPS) ? 60 : 15;
-	
 	format->format = *fmt;
 
-	printk(KERN_INFO "[O] thermal_get_fmt %08X %08X\n", format->format.code, format->format.colorspace);
-	
 	mutex_unlock(&sensor->lock);
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "[O] thermal_get_fmt\n");
@@ -545,10 +861,9 @@ static int thermal_try_fmt_internal(struct v4l2_subdev *sd,
 		*new_mode = (TRAWMODE_PARAM_T*)mode;
 	}
 
-	printk(KERN_INFO "[O] thermal_try_fmt_internal %08X\n", fmt->code);
-
 	fmt->code		= g_traw_pixfmt[0].code;
 	fmt->colorspace	= g_traw_pixfmt[0].colorspace;
+	fmt->field		= V4L2_FIELD_NONE;
 
 	
 	fmt->ycbcr_enc = V4L2_MAP_YCBCR_ENC_DEFAULT(fmt->colorspace);
@@ -568,7 +883,6 @@ static int thermal_set_fmt(struct v4l2_subdev *sd,
 {
 	TRAW_DEV_T*					sensor = to_traw_dev(sd);
 	struct v4l2_mbus_framefmt	*mbus_fmt = &format->format;
-	TRAWMODE_PARAM_T* 			new_mode;
 	int		ret;
 
 	#ifdef TRAWDRV_DBG_MSG
@@ -582,7 +896,7 @@ static int thermal_set_fmt(struct v4l2_subdev *sd,
 	mutex_lock(&sensor->lock);
 
 	ret = 0;
-	ret = thermal_try_fmt_internal(sd, mbus_fmt, sensor->curr_fr, &new_mode);
+	ret = thermal_try_fmt_internal(sd, mbus_fmt, sensor->curr_fr, NULL);
 	if ( ret ) {
 		goto set_fmt_out;
 	}
@@ -592,9 +906,7 @@ static int thermal_set_fmt(struct v4l2_subdev *sd,
 		goto set_fmt_out;
 	}
 
-	if ( thermal_comapre_param(new_mode, &(sensor->curr_mode)) ) {
-		thermal_copy_param(new_mode, &(sensor->curr_mode));
-	}
+	thermal_apply_fpga_mode(sensor);
 
 	sensor->fmt = *mbus_fmt;
 
@@ -653,10 +965,26 @@ static int thermal_set_ctrl_white_balance(TRAW_DEV_T* sensor, int awb)
 static int thermal_set_ctrl_exposure(TRAW_DEV_T* sensor,
 				    enum v4l2_exposure_auto_type auto_exposure)
 {
+	TRAW_CTRLS_T* ctrls = &sensor->ctrls;
+	bool auto_exp = (auto_exposure == V4L2_EXPOSURE_AUTO);
+	int ret = 0;
+
 	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "thermal_set_ctrl_exposure\n");	
+	printk(KERN_INFO "thermal_set_ctrl_exposure (%d %d)\n", auto_exposure, ctrls->exposure->val);	
 	#endif
-	return 0;
+
+	if ( ctrls->auto_exp->is_new ) {
+		ret = traw_write_reg(sensor, TRAW_REG_INT_MODE, auto_exp ? 1 : 0);
+		if ( ret ) {
+			return ret;
+		}
+	}
+
+	if ( !auto_exp && ctrls->exposure->is_new ) {
+		ret = traw_write_reg(sensor, TRAW_REG_INT_TIME, ctrls->exposure->val);
+	}
+
+	return ret;
 }
 
 static int thermal_set_ctrl_gain(TRAW_DEV_T* sensor, bool auto_gain)
@@ -683,66 +1011,164 @@ static int thermal_set_ctrl_vflip(TRAW_DEV_T* sensor, int value)
 	return 0;
 }
 
-static int thermal_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
+static int thermal_set_ctrl_snapshot_mode(TRAW_DEV_T* sensor, int value)
 {
-	//struct v4l2_subdev *sd = ctrl_to_sd(ctrl);
-	//TRAW_DEV_T* sensor = to_traw_dev(sd);
-	//int val;
+	#ifdef TRAWDRV_DBG_MSG
+	printk(KERN_INFO "thermal_set_ctrl_snapshot_mode (%d)\n", value);
+	#endif
+	return traw_write_reg(sensor, TRAW_REG_CAPTURE_MODE,
+				value ? TRAW_CAPTURE_SNAPSHOT : TRAW_CAPTURE_CONTINUOUS);
+}
 
-	/* v4l2_ctrl_lock() locks our own mutex */
+static int thermal_trigger_snapshot(TRAW_DEV_T* sensor)
+{
 	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "[I] thermal_g_volatile_ctrl\n");
+	printk(KERN_INFO "thermal_trigger_snapshot (%d)\n", sensor->ctrls.snapshot_count->val);
 	#endif
 
-	switch (ctrl->id) {
-	case V4L2_CID_AUTOGAIN:
-		break;
-	case V4L2_CID_EXPOSURE_AUTO:
-		break;
+	/*
+	 * The FPGA only emits frames on a trigger while it is in snapshot
+	 * mode and the receiver is running, anything else would be lost.
+	 * The trigger register takes the frame count itself so a shot costs
+	 * a single I2C transaction.
+	 */
+	if ( !sensor->streaming || !sensor->ctrls.snapshot_mode->val ) {
+		return -EBUSY;
 	}
 
+	return traw_write_reg(sensor, TRAW_REG_SNAPSHOT_TRIG,
+				sensor->ctrls.snapshot_count->val);
+}
+
+static int thermal_set_ctrl_decimation(TRAW_DEV_T* sensor, int value)
+{
 	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "[O] thermal_g_volatile_ctrl\n");
+	printk(KERN_INFO "thermal_set_ctrl_decimation (%d)\n", value);
 	#endif
 
-	return 0;
+	/* the core keeps its native rate, the FPGA drops frames before MIPI */
+	return traw_write_reg(sensor, TRAW_REG_FRAME_DECIM, value);
 }
 
-static int thermal_s_ctrl(struct v4l2_ctrl *ctrl)
+static int thermal_set_ctrl_test_pattern(TRAW_DEV_T* sensor, int value)
 {
-	struct v4l2_subdev *sd = ctrl_to_sd(ctrl);
-	TRAW_DEV_T* sensor = to_traw_dev(sd);
-	int ret;
+	#ifdef TRAWDRV_DBG_MSG
+	printk(KERN_INFO "thermal_set_ctrl_test_pattern (%d)\n", value);
+	#endif
+
+	if ( 0 == value ) {
+		return traw_write_reg(sensor, TRAW_REG_TEST_PATTERN, 0);
+	}
+
+	return traw_write_reg(sensor, TRAW_REG_TEST_PATTERN,
+				value | TRAW_TEST_PATTERN_STAMP);
+}
 
+static int thermal_set_ctrl_alarm(TRAW_DEV_T* sensor)
+{
+	TRAW_CTRLS_T* ctrls = &sensor->ctrls;
+	int ret;
 
 	#ifdef TRAWDRV_DBG_MSG
-	printk(KERN_INFO "[I] thermal_s_ctrl (%x)\n", ctrl->id);
+	printk(KERN_INFO "thermal_set_ctrl_alarm (%d %d %d)\n", ctrls->alarm_enable->val,
+			ctrls->alarm_threshold->val, ctrls->alarm_hysteresis->val);
 	#endif
 
-	/* v4l2_ctrl_lock() locks our own mutex */
+	/* disarm while the levels change so no half-updated edge fires */
+	ret = traw_write_reg(sensor, TRAW_REG_ALARM_CTRL, 0);
+	if ( ret ) {
+		return ret;
+	}
 
-	/*
-	 * If the device is not powered up by the host driver do
-	 * not apply any controls to H/W at this time. Instead
-	 * the controls will be restored right after power-up.
-	 */
-	if (sensor->power_count == 0)
-		return 0;
+	ret = traw_write_reg(sensor, TRAW_REG_ALARM_THRESH, ctrls->alarm_threshold->val);
+	if ( ret ) {
+		return ret;
+	}
 
-	switch (ctrl->id) {
-	case V4L2_CID_AUTOGAIN:
-		break;
-	case V4L2_CID_EXPOSURE_AUTO:
-		break;
-	case V4L2_CID_AUTO_WHITE_BALANCE:
-		break;
-	case V4L2_CID_HUE:
-		break;
-	case V4L2_CID_CONTRAST:
+	ret = traw_write_reg(sensor, TRAW_REG_ALARM_HYST, ctrls->alarm_hysteresis->val);
+	if ( ret ) {
+		return ret;
+	}
+
+	return traw_write_reg(sensor, TRAW_REG_ALARM_CTRL, ctrls->alarm_enable->val ? 1 : 0);
+}
+
+static int thermal_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct v4l2_subdev *sd = ctrl_to_sd(ctrl);
+	TRAW_DEV_T* sensor = to_traw_dev(sd);
+	u16 val;
+	int ret = 0;
+
+	/* v4l2_ctrl_lock() locks our own mutex */
+	#ifdef TRAWDRV_DBG_MSG
+	printk(KERN_INFO "[I] thermal_g_volatile_ctrl\n");
+	#endif
+
+	switch (ctrl->id) {
+	case V4L2_CID_AUTOGAIN:
+		break;
+	case V4L2_CID_EXPOSURE_AUTO:
+		/* report the integration time the FPGA settled on */
+		if ( ctrl->val == V4L2_EXPOSURE_AUTO ) {
+			ret = thermal_read_reg(sensor, TRAW_REG_INT_TIME, &val);
+			if ( 0 == ret ) {
+				sensor->ctrls.exposure->val = val;
+			}
+		}
+		break;
+	}
+
+	#ifdef TRAWDRV_DBG_MSG
+	printk(KERN_INFO "[O] thermal_g_volatile_ctrl\n");
+	#endif
+
+	return ret;
+}
+
+static int thermal_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct v4l2_subdev *sd = ctrl_to_sd(ctrl);
+	TRAW_DEV_T* sensor = to_traw_dev(sd);
+	int ret = 0;
+
+
+	#ifdef TRAWDRV_DBG_MSG
+	printk(KERN_INFO "[I] thermal_s_ctrl (%x)\n", ctrl->id);
+	#endif
+
+	/* v4l2_ctrl_lock() locks our own mutex */
+
+	/*
+	 * If the device is not powered up by the host driver do
+	 * not apply any controls to H/W at this time. Instead
+	 * the controls will be restored right after power-up
+	 * or stream-on. The alarm comparator is meant to run
+	 * without a stream, so it is always applied. The snapshot
+	 * trigger has no state to restore, it must reach
+	 * thermal_trigger_snapshot() to report -EBUSY.
+	 */
+	if (sensor->power_count == 0 && !sensor->streaming &&
+	    ctrl->cluster[0] != sensor->ctrls.alarm_enable &&
+	    ctrl->id != V4L2_CID_THERMAL_SNAPSHOT_TRIGGER)
+		return 0;
+
+	switch (ctrl->id) {
+	case V4L2_CID_AUTOGAIN:
+		break;
+	case V4L2_CID_EXPOSURE_AUTO:
+		ret = thermal_set_ctrl_exposure(sensor, ctrl->val);
+		break;
+	case V4L2_CID_AUTO_WHITE_BALANCE:
+		break;
+	case V4L2_CID_HUE:
+		break;
+	case V4L2_CID_CONTRAST:
 		break;
 	case V4L2_CID_SATURATION:
 		break;
 	case V4L2_CID_TEST_PATTERN:
+		ret = thermal_set_ctrl_test_pattern(sensor, ctrl->val);
 		break;
 	case V4L2_CID_POWER_LINE_FREQUENCY:
 		break;
@@ -750,6 +1176,20 @@ static int thermal_s_ctrl(struct v4l2_ctrl *ctrl)
 		break;
 	case V4L2_CID_VFLIP:
 		break;
+	case V4L2_CID_THERMAL_SNAPSHOT_MODE:
+		ret = thermal_set_ctrl_snapshot_mode(sensor, ctrl->val);
+		break;
+	case V4L2_CID_THERMAL_SNAPSHOT_COUNT:
+		break;
+	case V4L2_CID_THERMAL_SNAPSHOT_TRIGGER:
+		ret = thermal_trigger_snapshot(sensor);
+		break;
+	case V4L2_CID_THERMAL_FRAME_DECIMATION:
+		ret = thermal_set_ctrl_decimation(sensor, ctrl->val);
+		break;
+	case V4L2_CID_THERMAL_ALARM_ENABLE:
+		ret = thermal_set_ctrl_alarm(sensor);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -767,6 +1207,79 @@ static const struct v4l2_ctrl_ops thermal_ctrl_ops = {
 	.s_ctrl = thermal_s_ctrl,
 };
 
+static const struct v4l2_ctrl_config g_traw_ctrl_snapshot_mode = {
+	.ops	= &thermal_ctrl_ops,
+	.id		= V4L2_CID_THERMAL_SNAPSHOT_MODE,
+	.name	= "Snapshot Mode",
+	.type	= V4L2_CTRL_TYPE_BOOLEAN,
+	.min	= 0,
+	.max	= 1,
+	.step	= 1,
+	.def	= 0,
+};
+
+static const struct v4l2_ctrl_config g_traw_ctrl_snapshot_count = {
+	.ops	= &thermal_ctrl_ops,
+	.id		= V4L2_CID_THERMAL_SNAPSHOT_COUNT,
+	.name	= "Snapshot Frame Count",
+	.type	= V4L2_CTRL_TYPE_INTEGER,
+	.min	= 1,
+	.max	= TRAW_SNAPSHOT_MAX_FRAMES,
+	.step	= 1,
+	.def	= 1,
+};
+
+static const struct v4l2_ctrl_config g_traw_ctrl_snapshot_trigger = {
+	.ops	= &thermal_ctrl_ops,
+	.id		= V4L2_CID_THERMAL_SNAPSHOT_TRIGGER,
+	.name	= "Snapshot Trigger",
+	.type	= V4L2_CTRL_TYPE_BUTTON,
+};
+
+static const struct v4l2_ctrl_config g_traw_ctrl_decimation = {
+	.ops	= &thermal_ctrl_ops,
+	.id		= V4L2_CID_THERMAL_FRAME_DECIMATION,
+	.name	= "Frame Decimation",
+	.type	= V4L2_CTRL_TYPE_INTEGER,
+	.min	= 1,
+	.max	= TRAW_DECIMATION_MAX,
+	.step	= 1,
+	.def	= 1,
+};
+
+static const struct v4l2_ctrl_config g_traw_ctrl_alarm[] = {
+	{
+		.ops	= &thermal_ctrl_ops,
+		.id		= V4L2_CID_THERMAL_ALARM_ENABLE,
+		.name	= "Temperature Alarm",
+		.type	= V4L2_CTRL_TYPE_BOOLEAN,
+		.min	= 0,
+		.max	= 1,
+		.step	= 1,
+		.def	= 0,
+	},
+	{
+		.ops	= &thermal_ctrl_ops,
+		.id		= V4L2_CID_THERMAL_ALARM_THRESHOLD,
+		.name	= "Alarm Threshold",
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.min	= 0,
+		.max	= TRAW_COUNTS_MAX,
+		.step	= 1,
+		.def	= TRAW_COUNTS_MAX,
+	},
+	{
+		.ops	= &thermal_ctrl_ops,
+		.id		= V4L2_CID_THERMAL_ALARM_HYSTERESIS,
+		.name	= "Alarm Hysteresis",
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.min	= 0,
+		.max	= TRAW_COUNTS_MAX,
+		.step	= 1,
+		.def	= 64,
+	},
+};
+
 static int thermal_init_controls(TRAW_DEV_T* sensor)
 {
 	const struct v4l2_ctrl_ops*	ops = &thermal_ctrl_ops;
@@ -774,6 +1287,7 @@ static int thermal_init_controls(TRAW_DEV_T* sensor)
 	TRAW_CTRLS_T*				ctrls	= &sensor->ctrls;
 	struct v4l2_ctrl_handler*	hdl		= &ctrls->handler;
 
+	int max_exp;
 	int ret;
 
 	#ifdef TRAWDRV_DBG_MSG
@@ -796,6 +1310,14 @@ static int thermal_init_controls(TRAW_DEV_T* sensor)
 	ctrls->gain = v4l2_ctrl_new_std(hdl, ops, V4L2_CID_GAIN,
 					0, 1023, 1, 0);
 
+	/* Auto/manual integration time, range set by the core frame period */
+	max_exp = thermal_calc_max_integration(sensor);
+	ctrls->auto_exp = v4l2_ctrl_new_std_menu(hdl, ops, V4L2_CID_EXPOSURE_AUTO,
+						 V4L2_EXPOSURE_MANUAL, 0,
+						 V4L2_EXPOSURE_AUTO);
+	ctrls->exposure = v4l2_ctrl_new_std(hdl, ops, V4L2_CID_EXPOSURE,
+					    TRAW_INT_TIME_MIN_US, max_exp, 1, max_exp);
+
 	ctrls->saturation = v4l2_ctrl_new_std(hdl, ops, V4L2_CID_SATURATION,
 					      0, 255, 1, 64);
 	ctrls->hue = v4l2_ctrl_new_std(hdl, ops, V4L2_CID_HUE,
@@ -808,6 +1330,23 @@ static int thermal_init_controls(TRAW_DEV_T* sensor)
 	ctrls->vflip = v4l2_ctrl_new_std(hdl, ops, V4L2_CID_VFLIP,
 					 0, 1, 1, 0);
 
+	ctrls->test_pattern = v4l2_ctrl_new_std_menu_items(hdl, ops, V4L2_CID_TEST_PATTERN,
+						ARRAY_SIZE(g_traw_test_pattern_menu) - 1,
+						0, 0, g_traw_test_pattern_menu);
+
+	/* Snapshot capture */
+	ctrls->snapshot_mode = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_snapshot_mode, NULL);
+	ctrls->snapshot_count = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_snapshot_count, NULL);
+	ctrls->snapshot_trigger = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_snapshot_trigger, NULL);
+
+	/* Output frame decimation */
+	ctrls->decimation = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_decimation, NULL);
+
+	/* Temperature alarm, thresholds in raw counts */
+	ctrls->alarm_enable = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_alarm[0], NULL);
+	ctrls->alarm_threshold = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_alarm[1], NULL);
+	ctrls->alarm_hysteresis = v4l2_ctrl_new_custom(hdl, &g_traw_ctrl_alarm[2], NULL);
+
 	if (hdl->error) {
 		printk(KERN_INFO "[E] thermal_init_controls\n");
 		ret = hdl->error;
@@ -819,6 +1358,8 @@ static int thermal_init_controls(TRAW_DEV_T* sensor)
 	ctrls->gain->flags |= V4L2_CTRL_FLAG_VOLATILE;
 	
 	v4l2_ctrl_auto_cluster(2, &ctrls->auto_gain, 0, false);
+	v4l2_ctrl_auto_cluster(2, &ctrls->auto_exp, V4L2_EXPOSURE_MANUAL, true);
+	v4l2_ctrl_cluster(3, &ctrls->alarm_enable);
 
 	sensor->sd.ctrl_handler = hdl;
 	#ifdef TRAWDRV_DBG_MSG
@@ -854,10 +1395,18 @@ static int thermal_enum_frame_size(struct v4l2_subdev *sd,
 		return -EINVAL;
 	}
 
-	fse->min_width = sensor->curr_mode.hact;
+	if (fse->code != g_traw_pixfmt[0].code) {
+		#ifdef TRAWDRV_DBG_MSG
+		printk(KERN_INFO "[E] thermal_enum_frame_size fse->code EINVAL\n");
+		#endif
+		return -EINVAL;
+	}
+
+	/* what set_fmt accepts, a pending source change included */
+	fse->min_width = sensor->fpga_mode.hact;
 	fse->max_width = fse->min_width;
 
-	fse->min_height = sensor->curr_mode.vact;
+	fse->min_height = sensor->fpga_mode.vact;
 	fse->max_height = fse->min_height;
 	
 	#ifdef TRAWDRV_DBG_MSG
@@ -883,7 +1432,7 @@ static int thermal_enum_frame_interval(
 		return -EINVAL;
 	}
 
-	if (fie->index >= TRAW_NUM_FRAMERATES) {
+	if (fie->index >= ARRAY_SIZE(g_traw_decim)) {
 		#ifdef TRAWDRV_DBG_MSG
 		printk(KERN_INFO "[E] thermal_enum_frame_interval\n");
 		#endif
@@ -895,11 +1444,17 @@ static int thermal_enum_frame_interval(
 		return -EINVAL;
 	}
 
-	fie->interval.numerator = 1;
+	if (fie->code != g_traw_pixfmt[0].code) {
+		#ifdef TRAWDRV_DBG_MSG
+		printk(KERN_INFO "[E] thermal_enum_frame_interval (code)\n");
+		#endif
+		return -EINVAL;
+	}
 
-	if (fie->width  == sensor->curr_mode.hact && 
-		fie->height == sensor->curr_mode.vact) {
-		fie->interval.denominator = g_traw_fps[fie->index];
+	if (fie->width  == sensor->fpga_mode.hact && 
+		fie->height == sensor->fpga_mode.vact) {
+		fie->interval = sensor->frame_interval;
+		fie->interval.numerator *= g_traw_decim[fie->index];
 		#ifdef TRAWDRV_DBG_MSG
 		printk(KERN_INFO "[O] thermal_enum_frame_interval\n");
 		#endif
@@ -925,6 +1480,8 @@ static int thermal_g_frame_interval(struct v4l2_subdev *sd,
 
 	mutex_lock(&sensor->lock);
 	fi->interval = sensor->frame_interval;
+	/* report the interval actually seen on the bus */
+	fi->interval.numerator *= sensor->ctrls.decimation->val;
 	mutex_unlock(&sensor->lock);
 
 	#ifdef TRAWDRV_DBG_MSG
@@ -940,8 +1497,8 @@ static int thermal_s_frame_interval(struct v4l2_subdev *sd,
 				   	struct v4l2_subdev_frame_interval *fi)
 {
 	TRAW_DEV_T* sensor = to_traw_dev(sd);
-	const TRAWMODE_PARAM_T* mode;
-	int frame_rate, ret = 0;
+	u64 decim;
+	int ret = 0;
 
 	#ifdef TRAWDRV_DBG_MSG
 	printk(KERN_INFO "[I] thermal_s_frame_interval\n");
@@ -958,34 +1515,26 @@ static int thermal_s_frame_interval(struct v4l2_subdev *sd,
 		goto out;
 	}
 
-	mode = &(sensor->curr_mode);
-
-#if 0
-	frame_rate = thermal_try_frame_interval(sensor, &fi->interval, mode->hact, mode->vact);
-	if (frame_rate < 0) {
-		/* Always return a valid frame interval value */
-		printk(KERN_ERR "<<<<<<<<<<<<<<<<<<thermal_s_frame_interval (invalid framerates)\n");
-		fi->interval = sensor->frame_interval;
-		goto out;
-	}
-#endif
-	frame_rate = sensor->curr_fr;
-
-	mode = thermal_find_mode(sensor, frame_rate, mode->hact, mode->vact);
-	if (!mode) {
-		printk(KERN_ERR "[E] thermal_s_frame_interval (invalid mode)\n");
-		ret = -EINVAL;
-		goto out;
+	/*
+	 * The core runs at the fixed base rate of the bitstream, a requested
+	 * interval is met with FPGA decimation: the nearest whole multiple of
+	 * the base period.
+	 */
+	if (fi->interval.numerator && fi->interval.denominator) {
+		decim = DIV_ROUND_CLOSEST_ULL((u64)fi->interval.numerator *
+					      sensor->frame_interval.denominator,
+					      (u64)fi->interval.denominator *
+					      sensor->frame_interval.numerator);
+		decim = clamp_val(decim, 1, TRAW_DECIMATION_MAX);
+
+		ret = __v4l2_ctrl_s_ctrl(sensor->ctrls.decimation, decim);
+		if (ret)
+			goto out;
 	}
 
-	if ( thermal_comapre_param((TRAWMODE_PARAM_T*)mode, &(sensor->curr_mode)) || frame_rate != sensor->curr_fr ) {
-		sensor->curr_fr = frame_rate;
-		sensor->frame_interval = fi->interval;
-
-		thermal_copy_param((TRAWMODE_PARAM_T*)mode, &(sensor->curr_mode));
-
-		__v4l2_ctrl_s_ctrl_int64(sensor->ctrls.pixel_rate, thermal_calc_pixel_rate(sensor));
-	}
+	/* Always return the frame interval actually in use */
+	fi->interval = sensor->frame_interval;
+	fi->interval.numerator *= sensor->ctrls.decimation->val;
 out:
 	mutex_unlock(&sensor->lock);
 	#ifdef TRAWDRV_DBG_MSG
@@ -1024,6 +1573,156 @@ static int thermal_enum_mbus_code(struct v4l2_subdev *sd,
 	return 0;
 }
 
+/*
+ * The core frame counter keeps running in snapshot mode and with
+ * decimation, so a counter that stops moving means the FPGA is gone.
+ */
+static void thermal_wdt_work(struct work_struct *work)
+{
+	TRAW_DEV_T* sensor = container_of(to_delayed_work(work), TRAW_DEV_T, wdt_work);
+	struct device *dev = &sensor->i2c_client->dev;
+	u16 frame_cnt;
+	int ret;
+
+	mutex_lock(&sensor->lock);
+
+	if ( !sensor->streaming || 0 == wdt_interval_ms ) {
+		goto out;
+	}
+
+	ret = thermal_read_reg(sensor, TRAW_REG_FRAME_CNT, &frame_cnt);
+	if ( 0 == ret && frame_cnt != sensor->wdt_frame_cnt ) {
+		sensor->wdt_frame_cnt = frame_cnt;
+		sensor->wdt_miss = 0;
+		goto resched;
+	}
+
+	if ( ++sensor->wdt_miss < TRAW_WDT_MAX_MISS ) {
+		goto resched;
+	}
+
+	sensor->wdt_recover_cnt++;
+	dev_warn(dev, "stream stalled, recovering FPGA (%u)\n", sensor->wdt_recover_cnt);
+
+	/* restore what userspace configured, the node stays open */
+	ret = thermal_reinit(sensor);
+	if ( ret ) {
+		dev_err(dev, "FPGA recovery failed (%d), will retry\n", ret);
+	}
+
+	sensor->wdt_miss = 0;
+	thermal_read_reg(sensor, TRAW_REG_FRAME_CNT, &sensor->wdt_frame_cnt);
+
+resched:
+	schedule_delayed_work(&sensor->wdt_work, msecs_to_jiffies(wdt_interval_ms));
+out:
+	mutex_unlock(&sensor->lock);
+}
+
+/*
+ * Follow the resolution the FPGA reports. A reconfigured FPGA or a
+ * swapped core raises SOURCE_CHANGE so applications can renegotiate
+ * their buffers instead of rebooting.
+ */
+static void thermal_src_work(struct work_struct *work)
+{
+	TRAW_DEV_T* sensor = container_of(to_delayed_work(work), TRAW_DEV_T, src_work);
+	struct device *dev = &sensor->i2c_client->dev;
+	static const struct v4l2_event ev = {
+		.type = V4L2_EVENT_SOURCE_CHANGE,
+		.u.src_change.changes = V4L2_EVENT_SRC_CH_RESOLUTION,
+	};
+	u16 img_w, img_h;
+	int ret;
+
+	mutex_lock(&sensor->lock);
+
+	ret = 0;
+	ret += thermal_read_reg(sensor, TRAW_REG_RES_W, &img_w);
+	ret += thermal_read_reg(sensor, TRAW_REG_RES_H, &img_h);
+
+	/* an FPGA that does not answer is left to the watchdog */
+	if ( ret || 0 == img_w || 0 == img_h ) {
+		goto out;
+	}
+
+	if ( 0 == sensor->res_reg_w ) {
+		sensor->res_reg_w = img_w;
+		sensor->res_reg_h = img_h;
+		goto out;
+	}
+
+	if ( img_w == sensor->res_reg_w && img_h == sensor->res_reg_h ) {
+		goto out;
+	}
+
+	dev_info(dev, "FPGA resolution changed (%d:%d) -> (%d:%d)\n",
+			sensor->res_reg_w, sensor->res_reg_h, img_w, img_h);
+
+	sensor->res_reg_w = img_w;
+	sensor->res_reg_h = img_h;
+
+	sensor->fpga_mode.hact = img_w;
+	sensor->fpga_mode.htot = img_w;
+	sensor->fpga_mode.vact = img_h + TRAW_TELEMETRY_LINES;
+	sensor->fpga_mode.vtot = img_h + TRAW_TELEMETRY_LINES;
+
+	/* a running pipeline keeps its format until it is stopped */
+	if ( !sensor->streaming ) {
+		thermal_apply_fpga_mode(sensor);
+	}
+
+	v4l2_subdev_notify_event(&sensor->sd, &ev);
+
+out:
+	if ( src_poll_ms ) {
+		schedule_delayed_work(&sensor->src_work, msecs_to_jiffies(src_poll_ms));
+	}
+	mutex_unlock(&sensor->lock);
+}
+
+/*
+ * The FPGA comparator drives the alarm line while any pixel is above
+ * the threshold, so both edges are reported: raised and cleared.
+ */
+static irqreturn_t thermal_alarm_irq(int irq, void *dev_id)
+{
+	TRAW_DEV_T* sensor = dev_id;
+	TRAW_ALARM_EVT_T* alarm;
+	struct v4l2_event ev = {
+		.type = V4L2_EVENT_THERMAL_ALARM,
+	};
+	u16 status, peak, frame_cnt;
+	int ret;
+
+	alarm = (TRAW_ALARM_EVT_T*)ev.u.data;
+
+	mutex_lock(&sensor->lock);
+	ret = thermal_read_reg(sensor, TRAW_REG_ALARM_STATUS, &status);
+	if ( 0 == ret ) {
+		ret = thermal_read_reg(sensor, TRAW_REG_ALARM_PEAK, &peak);
+	}
+	if ( 0 == ret ) {
+		ret = thermal_read_reg(sensor, TRAW_REG_FRAME_CNT, &frame_cnt);
+	}
+	mutex_unlock(&sensor->lock);
+
+	/* no event rather than a made up one */
+	if ( ret ) {
+		dev_err_ratelimited(&sensor->i2c_client->dev,
+				    "alarm status read failed (%d)\n", ret);
+		return IRQ_HANDLED;
+	}
+
+	alarm->active		= status & 0x1;
+	alarm->peak			= peak;
+	alarm->frame_cnt	= frame_cnt;
+
+	v4l2_subdev_notify_event(&sensor->sd, &ev);
+
+	return IRQ_HANDLED;
+}
+
 static int thermal_s_stream(struct v4l2_subdev *sd, int enable)
 {
 	TRAW_DEV_T* sensor = to_traw_dev(sd);
@@ -1037,6 +1736,17 @@ static int thermal_s_stream(struct v4l2_subdev *sd, int enable)
 	mutex_lock(&sensor->lock);
 
 	if (sensor->streaming == !enable) {
+		/*
+		 * The link was validated against the current format. A source
+		 * change still pending needs a new set_fmt from userspace.
+		 */
+		if ( enable && thermal_comapre_param(&(sensor->fpga_mode), &(sensor->curr_mode)) ) {
+			dev_err(&client->dev, "FPGA mode %dx%d differs from the format, set_fmt first\n",
+				sensor->fpga_mode.hact, sensor->fpga_mode.vact);
+			ret = -EPIPE;
+			goto out;
+		}
+
 		ret = thermal_check_valid_mode(sensor,
 					      &(sensor->curr_mode),
 					      sensor->curr_fr);
@@ -1060,7 +1770,35 @@ static int thermal_s_stream(struct v4l2_subdev *sd, int enable)
 		} 
 		else {
 			ret = -1;
+			goto out;
+		}
+
+		if ( enable ) {
+			/* s_power is not called by every receiver, push controls now */
+			ret = __v4l2_ctrl_handler_setup(&sensor->ctrls.handler);
+			if ( ret && sensor->reset_gpio ) {
+				dev_warn(&client->dev, "control setup failed (%d), resetting FPGA\n", ret);
+				ret = thermal_reinit(sensor);
+			}
+
+			if ( ret ) {
+				sensor->streaming = false;
+				goto out;
+			}
+		}
+
+		if ( enable && wdt_interval_ms ) {
+			sensor->wdt_miss = 0;
+			thermal_read_reg(sensor, TRAW_REG_FRAME_CNT, &sensor->wdt_frame_cnt);
+			schedule_delayed_work(&sensor->wdt_work, msecs_to_jiffies(wdt_interval_ms));
 		}
+		else {
+			/* the work re-checks streaming under the lock */
+			cancel_delayed_work(&sensor->wdt_work);
+		}
+
+		/* capture mode can not change under a running pipeline */
+		__v4l2_ctrl_grab(sensor->ctrls.snapshot_mode, enable);
 	}
 out:
 	mutex_unlock(&sensor->lock);
@@ -1095,10 +1833,281 @@ static int thermal_g_register(struct v4l2_subdev *sd, struct v4l2_dbg_register *
 }
 #endif
 
+/*
+ * Register window for calibration tools: register N lives at byte
+ * offset 2 * N, big endian. Only whole registers can be moved.
+ */
+static ssize_t thermal_regs_read(struct file *filp, struct kobject *kobj,
+				 struct bin_attribute *attr, char *buf,
+				 loff_t off, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(kobj_to_dev(kobj));
+	TRAW_DEV_T* sensor = to_traw_dev(i2c_get_clientdata(client));
+	size_t done = 0;
+	int ret = 0;
+
+	if ( (off | count) & 1 ) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&sensor->lock);
+
+	while ( done < count ) {
+		size_t len = min_t(size_t, count - done, TRAW_BURST_BYTES);
+
+		ret = thermal_read_burst(sensor, (off + done) / 2, buf + done, len);
+		if ( ret ) {
+			break;
+		}
+
+		done += len;
+	}
+
+	mutex_unlock(&sensor->lock);
+
+	return done ? done : ret;
+}
+
+static ssize_t thermal_regs_write(struct file *filp, struct kobject *kobj,
+				  struct bin_attribute *attr, char *buf,
+				  loff_t off, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(kobj_to_dev(kobj));
+	TRAW_DEV_T* sensor = to_traw_dev(i2c_get_clientdata(client));
+	size_t done = 0;
+	int ret = 0;
+
+	if ( (off | count) & 1 ) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&sensor->lock);
+
+	while ( done < count ) {
+		size_t len = min_t(size_t, count - done, TRAW_BURST_BYTES);
+
+		ret = thermal_write_burst(sensor, (off + done) / 2, buf + done, len);
+		if ( ret ) {
+			break;
+		}
+
+		done += len;
+	}
+
+	mutex_unlock(&sensor->lock);
+
+	return done ? done : ret;
+}
+
+static struct bin_attribute g_traw_regs_attr = {
+	.attr	= { .name = "regs", .mode = 0600 },
+	.size	= TRAW_REGS_SIZE,
+	.read	= thermal_regs_read,
+	.write	= thermal_regs_write,
+};
+
+static int thermal_subscribe_event(struct v4l2_subdev *sd,
+				   struct v4l2_fh *fh,
+				   struct v4l2_event_subscription *sub)
+{
+	switch (sub->type) {
+	case V4L2_EVENT_SOURCE_CHANGE:
+		return v4l2_src_change_event_subdev_subscribe(sd, fh, sub);
+	case V4L2_EVENT_THERMAL_ALARM:
+		return v4l2_event_subscribe(fh, sub, 4, NULL);
+	default:
+		return v4l2_ctrl_subdev_subscribe_event(sd, fh, sub);
+	}
+}
+
+/*
+ * Health telemetry. hwmon readers only see the cache, so lm-sensors
+ * or a node exporter never put traffic on the camera I2C bus. The
+ * FPGA is only polled while powered, thermal_s_power() starts it.
+ */
+static void thermal_hwmon_work(struct work_struct *work)
+{
+	TRAW_DEV_T* sensor = container_of(to_delayed_work(work), TRAW_DEV_T, hwmon_work);
+	u16 fpa, fpga, ffc, mv, status;
+	int ret;
+
+	mutex_lock(&sensor->lock);
+
+	if ( sensor->power_count == 0 || !sensor->hwmon_dev ) {
+		sensor->hwmon_valid = false;
+		mutex_unlock(&sensor->lock);
+		return;
+	}
+
+	ret = 0;
+	ret += thermal_read_reg(sensor, TRAW_REG_FPA_TEMP, &fpa);
+	ret += thermal_read_reg(sensor, TRAW_REG_FPGA_TEMP, &fpga);
+	ret += thermal_read_reg(sensor, TRAW_REG_FFC_CNT, &ffc);
+	ret += thermal_read_reg(sensor, TRAW_REG_SUPPLY_MV, &mv);
+	ret += thermal_read_reg(sensor, TRAW_REG_SUPPLY_STATUS, &status);
+
+	sensor->hwmon_valid = (0 == ret);
+	if ( sensor->hwmon_valid ) {
+		sensor->hwmon_temp[0]		= (long)fpa * 10 - 273150;
+		sensor->hwmon_temp[1]		= (long)fpga * 10 - 273150;
+		sensor->hwmon_ffc_cnt		= ffc;
+		sensor->hwmon_supply_mv		= mv;
+		sensor->hwmon_supply_fault	= !(status & 0x1);
+	}
+
+	schedule_delayed_work(&sensor->hwmon_work,
+			      msecs_to_jiffies(max(hwmon_poll_ms, 100U)));
+
+	mutex_unlock(&sensor->lock);
+}
+
+#if IS_REACHABLE(CONFIG_HWMON)
+static umode_t thermal_hwmon_is_visible(const void *data,
+					enum hwmon_sensor_types type,
+					u32 attr, int channel)
+{
+	return 0444;
+}
+
+static int thermal_hwmon_read(struct device *dev, enum hwmon_sensor_types type,
+			      u32 attr, int channel, long *val)
+{
+	TRAW_DEV_T* sensor = dev_get_drvdata(dev);
+	int ret = 0;
+
+	mutex_lock(&sensor->lock);
+
+	if ( !sensor->hwmon_valid ) {
+		ret = -ENODATA;
+	}
+	else if ( type == hwmon_temp && attr == hwmon_temp_input ) {
+		*val = sensor->hwmon_temp[channel];
+	}
+	else if ( type == hwmon_in && attr == hwmon_in_input ) {
+		*val = sensor->hwmon_supply_mv;
+	}
+	else if ( type == hwmon_in && attr == hwmon_in_alarm ) {
+		*val = sensor->hwmon_supply_fault;
+	}
+	else {
+		ret = -EOPNOTSUPP;
+	}
+
+	mutex_unlock(&sensor->lock);
+
+	return ret;
+}
+
+static int thermal_hwmon_read_string(struct device *dev,
+				     enum hwmon_sensor_types type,
+				     u32 attr, int channel, const char **str)
+{
+	static const char * const temp_label[] = { "FPA", "FPGA" };
+
+	if ( type == hwmon_temp ) {
+		*str = temp_label[channel];
+	}
+	else {
+		*str = "supply";
+	}
+
+	return 0;
+}
+
+static const struct hwmon_channel_info * const g_traw_hwmon_info[] = {
+	HWMON_CHANNEL_INFO(temp,
+			   HWMON_T_INPUT | HWMON_T_LABEL,
+			   HWMON_T_INPUT | HWMON_T_LABEL),
+	HWMON_CHANNEL_INFO(in,
+			   HWMON_I_INPUT | HWMON_I_LABEL | HWMON_I_ALARM),
+	NULL
+};
+
+static const struct hwmon_ops g_traw_hwmon_ops = {
+	.is_visible		= thermal_hwmon_is_visible,
+	.read			= thermal_hwmon_read,
+	.read_string	= thermal_hwmon_read_string,
+};
+
+static const struct hwmon_chip_info g_traw_hwmon_chip = {
+	.ops	= &g_traw_hwmon_ops,
+	.info	= g_traw_hwmon_info,
+};
+
+/* FFC count has no hwmon class, export it next to the standard files */
+static ssize_t ffc_count_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	TRAW_DEV_T* sensor = dev_get_drvdata(dev);
+	ssize_t ret;
+
+	mutex_lock(&sensor->lock);
+	ret = sensor->hwmon_valid ? sysfs_emit(buf, "%u\n", sensor->hwmon_ffc_cnt) : -ENODATA;
+	mutex_unlock(&sensor->lock);
+
+	return ret;
+}
+static DEVICE_ATTR_RO(ffc_count);
+
+static struct attribute *g_traw_hwmon_attrs[] = {
+	&dev_attr_ffc_count.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(g_traw_hwmon);
+
+/*
+ * Not devm: the hwmon files take sensor->lock, so they have to go before
+ * thermal_remove() destroys it.
+ */
+static int thermal_hwmon_init(TRAW_DEV_T* sensor)
+{
+	struct device *dev = &sensor->i2c_client->dev;
+	struct device *hwmon;
+
+	hwmon = hwmon_device_register_with_info(dev, "traw", sensor,
+						&g_traw_hwmon_chip,
+						g_traw_hwmon_groups);
+	if ( IS_ERR(hwmon) ) {
+		return PTR_ERR(hwmon);
+	}
+
+	mutex_lock(&sensor->lock);
+	sensor->hwmon_dev = hwmon;
+	mutex_unlock(&sensor->lock);
+
+	return 0;
+}
+
+static void thermal_hwmon_exit(TRAW_DEV_T* sensor)
+{
+	struct device *hwmon = sensor->hwmon_dev;
+
+	if ( !hwmon ) {
+		return;
+	}
+
+	mutex_lock(&sensor->lock);
+	sensor->hwmon_dev = NULL;
+	mutex_unlock(&sensor->lock);
+
+	cancel_delayed_work_sync(&sensor->hwmon_work);
+	hwmon_device_unregister(hwmon);
+}
+#else
+static int thermal_hwmon_init(TRAW_DEV_T* sensor)
+{
+	return 0;
+}
+
+static void thermal_hwmon_exit(TRAW_DEV_T* sensor)
+{
+}
+#endif
+
 static const struct v4l2_subdev_core_ops thermal_core_ops = {
 	.s_power = thermal_s_power,
 	.log_status = v4l2_ctrl_subdev_log_status,
-	.subscribe_event = v4l2_ctrl_subdev_subscribe_event,
+	.subscribe_event = thermal_subscribe_event,
 	.unsubscribe_event = v4l2_event_subdev_unsubscribe,
 #ifdef CONFIG_VIDEO_ADV_DEBUG
 	.g_register	= thermal_g_register,
@@ -1240,69 +2249,59 @@ static int thermal_probe(struct i2c_client *client)
 
 	//printk(KERN_INFO ">>>>>>>>>>>>>>>>>>BUSTYPE %d\n", sensor->ep.bus_type);
 
-	if ( 0 == g_f_fpga_det ) {	//	FPGA DETECTION
-		int			wait_cnt;
-
-		printk(KERN_INFO ">>>>>>>>> FIRST FPGA DETECTION\n");
+	sensor->reset_gpio = devm_gpiod_get_optional(dev, "reset", GPIOD_OUT_LOW);
+	if ( IS_ERR(sensor->reset_gpio) ) {
+		dev_err(dev, "Could not get reset gpio\n");
+		return PTR_ERR(sensor->reset_gpio);
+	}
 
-		msleep(500);
+	init_completion(&sensor->ready_done);
 
-		//	일초 동안 대기
-		//usleep_range(1500000, 2000000);
-		
-		wait_cnt = 0;
-		while ( 1 ) {
-			u16			img_w, img_h;
-                
-                
-			wait_cnt++;
-			if ( 300 <= wait_cnt ) {
-				printk(KERN_INFO ">>>>>>>>> FPGA WAIT TIMEOUT\n");
-				break;		
-			}
-                
-			ret = 0;
-			ret += thermal_read_reg(sensor, 0x0200, &img_w);
-			ret += thermal_read_reg(sensor, 0x0201, &img_h);
-			
-			if ( 0 == ret ) {
-				printk(KERN_INFO ">>>>>>>>> FPGA READ %d %d\n", img_w, img_h);
-				break;
-			}
-		
-			msleep(5);
-		}
+	sensor->ready_gpio = devm_gpiod_get_optional(dev, "ready", GPIOD_IN);
+	if ( IS_ERR(sensor->ready_gpio) ) {
+		dev_err(dev, "Could not get ready gpio\n");
+		return PTR_ERR(sensor->ready_gpio);
+	}
 
-		if ( 300 <= wait_cnt ) {
-			dev_err(dev, "thermal:Can`t received ready signal!\n");
-			
-			return -EINVAL;
+	if ( sensor->ready_gpio ) {
+		ret = gpiod_to_irq(sensor->ready_gpio);
+		if ( ret < 0 ) {
+			//	edge 를 못 받으면 I2C polling 으로 감지
+			dev_err(dev, "ready gpio has no irq (%d), polling the FPGA instead\n", ret);
+			sensor->ready_gpio = NULL;
 		}
 		else {
-			u16			img_w, img_h;
-
-
-			//	해상도를 읽어서 V4L2 기본 설정 진행
-			ret = thermal_read_reg(sensor, 0x0200, &img_w);
-			ret = thermal_read_reg(sensor, 0x0201, &img_h);
+			ret = devm_request_irq(dev, ret,
+					       thermal_ready_irq, IRQF_TRIGGER_RISING,
+					       dev_name(dev), sensor);
+			if ( ret ) {
+				dev_err(dev, "Could not request ready irq (%d)\n", ret);
+				return ret;
+			}
+		}
+	}
 
-			g_res_w = img_w;
-			g_res_h = 289;
+	sensor->alarm_gpio = devm_gpiod_get_optional(dev, "alarm", GPIOD_IN);
+	if ( IS_ERR(sensor->alarm_gpio) ) {
+		dev_err(dev, "Could not get alarm gpio\n");
+		return PTR_ERR(sensor->alarm_gpio);
+	}
 
-			printk(KERN_INFO ">>>>>>>>> FPGA RES (%04d:%04d)\n", g_res_w, g_res_h);
+	if ( 0 == g_f_fpga_det ) {	//	FPGA DETECTION
+		printk(KERN_INFO ">>>>>>>>> FIRST FPGA DETECTION\n");
 
-			if ( g_traw_mode_param.hact == g_res_w &&
-				g_traw_mode_param.vact == g_res_h ) {
-				g_traw_id = TRAW_MODE_QVGA_384_289;				
-			}
-			else {
-				dev_err(dev, "thermal:invalid resolution (%04d:%04d)\n", g_res_w, g_res_h);
+		//	reset 또는 ready 신호가 있으면 고정 대기 없이 감지
+		if ( sensor->reset_gpio ) {
+			thermal_reset(sensor);
+		}
+		else if ( NULL == sensor->ready_gpio ) {
+			msleep(500);
+		}
 
-				g_traw_id = TRAW_MODE_QVGA_384_289;
+		if ( thermal_detect_fpga(sensor, TRAW_FPGA_WAIT_CNT) ) {
+			dev_err(dev, "thermal:Can`t received ready signal!\n");
 
-				g_res_w = 384;
-				g_res_h = 289;
-			}
+			return -EINVAL;
 		}
 
 		sensor->curr_mode.id = g_traw_mode_param.id;
@@ -1330,9 +2329,15 @@ static int thermal_probe(struct i2c_client *client)
 
 	sensor->curr_fr		= TRAW_60_FPS;	
 	thermal_copy_param(&(sensor->curr_mode), &(sensor->last_mode));
+	thermal_copy_param(&(sensor->curr_mode), &(sensor->fpga_mode));
 
 	mutex_init(&sensor->lock);
-	if ( thermal_init_controls(sensor) ) {
+	INIT_DELAYED_WORK(&sensor->wdt_work, thermal_wdt_work);
+	INIT_DELAYED_WORK(&sensor->src_work, thermal_src_work);
+	INIT_DELAYED_WORK(&sensor->hwmon_work, thermal_hwmon_work);
+
+	ret = thermal_init_controls(sensor);
+	if ( ret ) {
 		goto mutex_destroy;
 	}	
 	
@@ -1352,20 +2357,65 @@ static int thermal_probe(struct i2c_client *client)
 			
 	//mutex_init(&sensor->lock);
 	//thermal_init_controls(sensor);
+
+	if ( sensor->alarm_gpio ) {
+		sensor->alarm_irq = gpiod_to_irq(sensor->alarm_gpio);
+		if ( sensor->alarm_irq < 0 ) {
+			ret = sensor->alarm_irq;
+			dev_err(dev, "alarm gpio has no irq (%d)\n", ret);
+			goto entity_cleanup;
+		}
+
+		ret = devm_request_threaded_irq(dev, sensor->alarm_irq, NULL,
+						thermal_alarm_irq,
+						IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING | IRQF_ONESHOT,
+						dev_name(dev), sensor);
+		if ( ret ) {
+			dev_err(dev, "Could not request alarm irq (%d)\n", ret);
+			goto entity_cleanup;
+		}
+	}
+
+	ret = device_create_bin_file(dev, &g_traw_regs_attr);
+	if ( ret ) {
+		dev_err(dev, "thermal:error register window\n");
+		goto free_alarm_irq;
+	}
 		
+	ret = thermal_hwmon_init(sensor);
+	if ( ret ) {
+		dev_err(dev, "thermal:error hwmon register (%d)\n", ret);
+		goto remove_regs;
+	}
+
 	ret = v4l2_async_register_subdev_sensor(&sensor->sd);
 	if ( ret )
-		goto free_ctrls;
+		goto hwmon_exit;
+
+	if ( src_poll_ms ) {
+		schedule_delayed_work(&sensor->src_work, msecs_to_jiffies(src_poll_ms));
+	}
 
 	printk(KERN_INFO "<<<<<<<<<<<<<<<<<< THERMAL VIDEO PROBE OUT\n");
 	
 	return 0;
 
-free_ctrls:
-	v4l2_ctrl_handler_free(&sensor->ctrls.handler);
-	
+hwmon_exit:
+	thermal_hwmon_exit(sensor);
+
+remove_regs:
+	device_remove_bin_file(dev, &g_traw_regs_attr);
+
+free_alarm_irq:
+	/* devm would release it only after the ctrls and the lock are gone */
+	if ( sensor->alarm_gpio ) {
+		devm_free_irq(dev, sensor->alarm_irq, sensor);
+	}
+
 entity_cleanup:
 	media_entity_cleanup(&sensor->sd.entity);
+
+free_ctrls:
 	v4l2_ctrl_handler_free(&sensor->ctrls.handler);
 
 mutex_destroy:
@@ -1379,6 +2429,14 @@ static void thermal_remove(struct i2c_client *client)
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
 	TRAW_DEV_T* sensor = to_traw_dev(sd);
 
+	if ( sensor->alarm_gpio ) {
+		disable_irq(sensor->alarm_irq);
+	}
+
+	cancel_delayed_work_sync(&sensor->wdt_work);
+	cancel_delayed_work_sync(&sensor->src_work);
+	thermal_hwmon_exit(sensor);
+	device_remove_bin_file(&client->dev, &g_traw_regs_attr);
 	v4l2_async_unregister_subdev(&sensor->sd);
 	media_entity_cleanup(&sensor->sd.entity);
 	v4l2_ctrl_handler_free(&sensor->ctrls.handler);
@@ -1413,6 +2471,10 @@ static struct i2c_driver thermal_i2c_driver = {
 
 module_i2c_driver(thermal_i2c_driver);
 
+#if IS_ENABLED(CONFIG_VIDEO_TCAM_RAW_KUNIT_TEST)
+#include "tcam-raw-test.c"
+#endif
+
 MODULE_AUTHOR("COX Co.Ltd <csi@coxcamera.com>");
 MODULE_DESCRIPTION("THERMAL VIDEO MIPI Camera Subdev Driver");
 MODULE_LICENSE("GPL v2");
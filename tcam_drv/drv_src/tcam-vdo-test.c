@@ -0,0 +1,691 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * KUnit tests for the tcam-vdo pad and control ops, no hardware needed.
+ *
+ * Included at the end of tcam-vdo.c (CONFIG_VIDEO_TCAM_VDO_KUNIT_TEST) so
+ * the static ops are reachable. The FPGA is a fake I2C adapter holding a
+ * 16-bit register file, same as the tcam-raw suite.
+ *
+ *   ./tools/testing/kunit/kunit.py run --arch=um \
+ *       --kunitconfig=drivers/media/i2c/tcam_drv/drv_src
+ *
+ * Copyright (C).
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+
+#define		TVDO_TEST_REGS			(0x400)		//	covers every TVDO_REG_*
+#define		TVDO_TEST_BENCH_LOOPS	(1000)
+
+typedef struct __thermal_video_test__ {
+	struct i2c_adapter	adap;
+	struct i2c_client*	client;
+	TVDO_DEV_T			sensor;
+
+	/* fake FPGA */
+	u16					regs[TVDO_TEST_REGS];
+	unsigned int		ptr;		//	auto-increment address
+	int					xfers;		//	messages seen
+	int					fail;		//	!0: every message fails with it
+} TVDO_TEST_T;
+
+static int thermal_test_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	TVDO_TEST_T* tt = i2c_get_adapdata(adap);
+	struct i2c_msg* msg;
+	int i, j;
+
+	for (i = 0; i < num; i++) {
+		msg = &msgs[i];
+		tt->xfers++;
+
+		if ( tt->fail ) {
+			return tt->fail;
+		}
+
+		if ( msg->addr != TVDO_SLAVE_ID ) {
+			return -ENXIO;
+		}
+
+		if ( msg->flags & I2C_M_RD ) {
+			for (j = 0; j + 1 < msg->len; j += 2, tt->ptr++) {
+				msg->buf[j]		= tt->regs[tt->ptr % TVDO_TEST_REGS] >> 8;
+				msg->buf[j + 1]	= tt->regs[tt->ptr % TVDO_TEST_REGS] & 0xff;
+			}
+			continue;
+		}
+
+		if ( msg->len < 2 ) {
+			return -EINVAL;
+		}
+
+		tt->ptr = msg->buf[0] << 8 | msg->buf[1];
+		for (j = 2; j + 1 < msg->len; j += 2, tt->ptr++) {
+			tt->regs[tt->ptr % TVDO_TEST_REGS] = msg->buf[j] << 8 | msg->buf[j + 1];
+		}
+	}
+
+	return num;
+}
+
+static u32 thermal_test_func(struct i2c_adapter *adap)
+{
+	return I2C_FUNC_I2C;
+}
+
+static const struct i2c_algorithm thermal_test_algo = {
+	.master_xfer	= thermal_test_xfer,
+	.functionality	= thermal_test_func,
+};
+
+/* the part of thermal_probe() that does not need the FPGA */
+static int thermal_test_init(struct kunit *test)
+{
+	TVDO_TEST_T* tt;
+	TVDO_DEV_T* sensor;
+	int ret;
+
+	tt = kunit_kzalloc(test, sizeof(*tt), GFP_KERNEL);
+	if ( !tt ) {
+		return -ENOMEM;
+	}
+
+	tt->adap.owner	= THIS_MODULE;
+	tt->adap.algo	= &thermal_test_algo;
+	strscpy(tt->adap.name, "tcam-vdo-test", sizeof(tt->adap.name));
+	i2c_set_adapdata(&tt->adap, tt);
+
+	ret = i2c_add_adapter(&tt->adap);
+	if ( ret ) {
+		return ret;
+	}
+
+	tt->client = i2c_new_dummy_device(&tt->adap, TVDO_SLAVE_ID);
+	if ( IS_ERR(tt->client) ) {
+		i2c_del_adapter(&tt->adap);
+		return PTR_ERR(tt->client);
+	}
+
+	sensor = &tt->sensor;
+	sensor->i2c_client = tt->client;
+
+	thermal_copy_param((TVDOMODE_PARAM_T*)&g_tvdo_mode_param, &(sensor->curr_mode));
+	thermal_copy_param((TVDOMODE_PARAM_T*)&g_tvdo_mode_param, &(sensor->fpga_mode));
+
+	sensor->curr_fr						= TVDO_30_FPS;
+	sensor->frame_interval.numerator	= 1;
+	sensor->frame_interval.denominator	= g_tvdo_fps[TVDO_30_FPS];
+	sensor->fmt.width					= g_tvdo_mode_param.hact;
+	sensor->fmt.height					= g_tvdo_mode_param.vact;
+
+	mutex_init(&sensor->lock);
+
+	ret = thermal_init_controls(sensor);
+	if ( ret ) {
+		mutex_destroy(&sensor->lock);
+		i2c_unregister_device(tt->client);
+		i2c_del_adapter(&tt->adap);
+		return ret;
+	}
+
+	v4l2_i2c_subdev_init(&sensor->sd, tt->client, &thermal_subdev_ops);
+
+	test->priv = tt;
+
+	return 0;
+}
+
+static void thermal_test_exit(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+
+	v4l2_ctrl_handler_free(&tt->sensor.ctrls.handler);
+	mutex_destroy(&tt->sensor.lock);
+	i2c_unregister_device(tt->client);
+	i2c_del_adapter(&tt->adap);
+}
+
+/* power_count only, thermal_set_power() would go for the regulators */
+static void thermal_test_power(TVDO_TEST_T* tt, bool on)
+{
+	tt->sensor.power_count = on ? 1 : 0;
+}
+
+/*
+ * Modes
+ */
+static void thermal_test_find_mode(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_DEV_T* sensor = &tt->sensor;
+	int fr;
+
+	for (fr = 0; fr < TVDO_NUM_FRAMERATES; fr++) {
+		KUNIT_EXPECT_PTR_EQ(test, thermal_find_mode(sensor, fr, 384, 288),
+				    (const TVDOMODE_PARAM_T*)&sensor->fpga_mode);
+	}
+
+	KUNIT_EXPECT_NULL(test, thermal_find_mode(sensor, TVDO_NUM_FRAMERATES, 384, 288));
+	KUNIT_EXPECT_NULL(test, thermal_find_mode(sensor, TVDO_30_FPS, 384, 289));
+	KUNIT_EXPECT_NULL(test, thermal_find_mode(sensor, TVDO_30_FPS, 640, 288));
+	KUNIT_EXPECT_NULL(test, thermal_find_mode(sensor, TVDO_30_FPS, 0, 0));
+
+	/* follows what the FPGA reports, not the table */
+	sensor->fpga_mode.hact = 640;
+	sensor->fpga_mode.vact = 513;
+	KUNIT_EXPECT_NULL(test, thermal_find_mode(sensor, TVDO_30_FPS, 384, 288));
+	KUNIT_EXPECT_NOT_NULL(test, thermal_find_mode(sensor, TVDO_30_FPS, 640, 513));
+}
+
+static void thermal_test_try_fmt(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	struct v4l2_mbus_framefmt fmt = {
+		.width		= 384,
+		.height		= 288,
+		.code		= MEDIA_BUS_FMT_UYVY8_1X16,
+		.field		= V4L2_FIELD_INTERLACED,
+		.reserved	= { 0xff },
+	};
+	TVDOMODE_PARAM_T* mode = NULL;
+
+	KUNIT_ASSERT_EQ(test, thermal_try_fmt_internal(&tt->sensor.sd, &fmt, TVDO_30_FPS, &mode), 0);
+	KUNIT_EXPECT_PTR_EQ(test, mode, &tt->sensor.fpga_mode);
+
+	/* the one bus format wins over whatever was asked for */
+	KUNIT_EXPECT_EQ(test, fmt.width, 384);
+	KUNIT_EXPECT_EQ(test, fmt.height, 288);
+	KUNIT_EXPECT_EQ(test, fmt.code, g_tvdo_pixfmt[0].code);
+	KUNIT_EXPECT_EQ(test, fmt.colorspace, g_tvdo_pixfmt[0].colorspace);
+	KUNIT_EXPECT_EQ(test, fmt.field, V4L2_FIELD_NONE);
+	KUNIT_EXPECT_EQ(test, fmt.quantization, V4L2_QUANTIZATION_FULL_RANGE);
+	KUNIT_EXPECT_EQ(test, fmt.reserved[0], 0);
+
+	/* new_mode is optional */
+	KUNIT_EXPECT_EQ(test, thermal_try_fmt_internal(&tt->sensor.sd, &fmt, TVDO_08_FPS, NULL), 0);
+
+	fmt.height = 289;
+	KUNIT_EXPECT_EQ(test, thermal_try_fmt_internal(&tt->sensor.sd, &fmt, TVDO_30_FPS, NULL), -EINVAL);
+
+	fmt.height = 288;
+	KUNIT_EXPECT_EQ(test, thermal_try_fmt_internal(&tt->sensor.sd, &fmt, TVDO_NUM_FRAMERATES, NULL),
+			-EINVAL);
+}
+
+/*
+ * Pad ops
+ */
+static void thermal_test_enum_frame_size(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	struct v4l2_subdev_frame_size_enum fse = {
+		.code = g_tvdo_pixfmt[0].code,
+	};
+
+	KUNIT_ASSERT_EQ(test, thermal_enum_frame_size(&tt->sensor.sd, NULL, &fse), 0);
+	KUNIT_EXPECT_EQ(test, fse.min_width, 384);
+	KUNIT_EXPECT_EQ(test, fse.max_width, 384);
+	KUNIT_EXPECT_EQ(test, fse.min_height, 288);
+	KUNIT_EXPECT_EQ(test, fse.max_height, 288);
+
+	fse.index = 1;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_size(&tt->sensor.sd, NULL, &fse), -EINVAL);
+
+	fse.index = 0;
+	fse.pad = 1;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_size(&tt->sensor.sd, NULL, &fse), -EINVAL);
+
+	fse.pad = 0;
+	fse.code = MEDIA_BUS_FMT_UYVY8_1X16;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_size(&tt->sensor.sd, NULL, &fse), -EINVAL);
+
+	fse.code = 0;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_size(&tt->sensor.sd, NULL, &fse), -EINVAL);
+}
+
+static void thermal_test_enum_frame_interval(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	struct v4l2_subdev_frame_interval fi = {};
+	struct v4l2_subdev_frame_interval_enum fie = {
+		.code	= g_tvdo_pixfmt[0].code,
+		.width	= 384,
+		.height	= 288,
+	};
+	int i;
+
+	/* whole multiples of the core period, each one s_frame_interval keeps */
+	for (i = 0; i < ARRAY_SIZE(g_tvdo_decim); i++) {
+		fie.index = i;
+		KUNIT_ASSERT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), 0);
+		KUNIT_EXPECT_EQ(test, fie.interval.numerator, g_tvdo_decim[i]);
+		KUNIT_EXPECT_EQ(test, fie.interval.denominator, 30);
+
+		fi.interval = fie.interval;
+		KUNIT_ASSERT_EQ(test, thermal_s_frame_interval(&tt->sensor.sd, NULL, &fi), 0);
+		KUNIT_EXPECT_EQ(test, fi.interval.numerator, fie.interval.numerator);
+		KUNIT_EXPECT_EQ(test, fi.interval.denominator, fie.interval.denominator);
+	}
+
+	fie.index = ARRAY_SIZE(g_tvdo_decim);
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+
+	fie.index = 0;
+	fie.pad = 1;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+
+	fie.pad = 0;
+	fie.code = MEDIA_BUS_FMT_UYVY8_1X16;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+
+	fie.code = 0;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+
+	fie.code = g_tvdo_pixfmt[0].code;
+	fie.height = 289;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+
+	fie.width = 0;
+	KUNIT_EXPECT_EQ(test, thermal_enum_frame_interval(&tt->sensor.sd, NULL, &fie), -EINVAL);
+}
+
+typedef struct __thermal_video_test_fi__ {
+	struct v4l2_fract	req;
+	u32					decimation;		//	expected
+} TVDO_TEST_FI_T;
+
+/* 30 fps core, intervals are whole multiples of 1/30 */
+static const TVDO_TEST_FI_T g_tvdo_test_fi[] = {
+	{ { 1, 30 },		1 },
+	{ { 1, 60 },		1 },	//	faster than the core
+	{ { 1, 15 },		2 },
+	{ { 4, 30 },		4 },	//	7.5 fps, as enumerated
+	{ { 1, 8 },			4 },	//	not offered, nearest multiple
+	{ { 1, 1 },			30 },
+	{ { 120, 1 },		TVDO_DECIMATION_MAX },
+	{ { 3600, 1 },		TVDO_DECIMATION_MAX },
+	{ { 1001, 30000 },	1 },
+};
+
+static void thermal_test_fi_desc(const TVDO_TEST_FI_T* p, char* desc)
+{
+	snprintf(desc, KUNIT_PARAM_DESC_SIZE, "%u/%u", p->req.numerator, p->req.denominator);
+}
+
+KUNIT_ARRAY_PARAM(thermal_test_fi, g_tvdo_test_fi, thermal_test_fi_desc);
+
+static void thermal_test_s_frame_interval(struct kunit *test)
+{
+	const TVDO_TEST_FI_T* p = test->param_value;
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_DEV_T* sensor = &tt->sensor;
+	struct v4l2_subdev_frame_interval fi = {
+		.interval = p->req,
+	};
+	s64 max_exp = sensor->ctrls.exposure->maximum;
+
+	thermal_test_power(tt, true);
+
+	KUNIT_ASSERT_EQ(test, thermal_s_frame_interval(&sensor->sd, NULL, &fi), 0);
+
+	/* the interval in use comes back, not the one asked for */
+	KUNIT_EXPECT_EQ(test, fi.interval.numerator, p->decimation);
+	KUNIT_EXPECT_EQ(test, fi.interval.denominator, 30);
+	KUNIT_EXPECT_EQ(test, sensor->ctrls.decimation->val, p->decimation);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_FRAME_DECIM],
+			p->decimation == 1 ? 0 : p->decimation);	//	default 1 is not written
+
+	/* the core period still bounds integration */
+	KUNIT_EXPECT_EQ(test, sensor->ctrls.exposure->maximum, max_exp);
+
+	memset(&fi, 0, sizeof(fi));
+	KUNIT_ASSERT_EQ(test, thermal_g_frame_interval(&sensor->sd, NULL, &fi), 0);
+	KUNIT_EXPECT_EQ(test, fi.interval.numerator, p->decimation);
+	KUNIT_EXPECT_EQ(test, fi.interval.denominator, 30);
+}
+
+static void thermal_test_s_frame_interval_reject(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_DEV_T* sensor = &tt->sensor;
+	struct v4l2_subdev_frame_interval fi = {
+		.interval = { 1, 15 },
+	};
+
+	fi.pad = 1;
+	KUNIT_EXPECT_EQ(test, thermal_s_frame_interval(&sensor->sd, NULL, &fi), -EINVAL);
+
+	fi.pad = 0;
+	sensor->streaming = true;
+	KUNIT_EXPECT_EQ(test, thermal_s_frame_interval(&sensor->sd, NULL, &fi), -EBUSY);
+	sensor->streaming = false;
+	KUNIT_EXPECT_EQ(test, sensor->ctrls.decimation->val, 1);
+
+	/* a zero interval only reads back */
+	fi.interval.numerator	= 0;
+	fi.interval.denominator	= 0;
+	KUNIT_ASSERT_EQ(test, thermal_s_frame_interval(&sensor->sd, NULL, &fi), 0);
+	KUNIT_EXPECT_EQ(test, fi.interval.numerator, 1);
+	KUNIT_EXPECT_EQ(test, fi.interval.denominator, 30);
+
+	/* unpowered: the control keeps the value, the FPGA gets it on power up */
+	fi.interval.numerator	= 1;
+	fi.interval.denominator	= 15;
+	KUNIT_ASSERT_EQ(test, thermal_s_frame_interval(&sensor->sd, NULL, &fi), 0);
+	KUNIT_EXPECT_EQ(test, sensor->ctrls.decimation->val, 2);
+	KUNIT_EXPECT_EQ(test, tt->xfers, 0);
+}
+
+static void thermal_test_source_change(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_DEV_T* sensor = &tt->sensor;
+	struct v4l2_subdev_frame_size_enum fse = {
+		.code = g_tvdo_pixfmt[0].code,
+	};
+	struct v4l2_subdev_format format = {
+		.which	= V4L2_SUBDEV_FORMAT_ACTIVE,
+		.format	= {
+			.width	= 640,
+			.height	= 513,
+		},
+	};
+
+	/* the FPGA changed size under a configured pipeline */
+	sensor->fpga_mode.hact = 640;
+	sensor->fpga_mode.vact = 513;
+
+	/* enumerated as set_fmt will take it */
+	KUNIT_ASSERT_EQ(test, thermal_enum_frame_size(&sensor->sd, NULL, &fse), 0);
+	KUNIT_EXPECT_EQ(test, fse.max_width, 640);
+	KUNIT_EXPECT_EQ(test, fse.max_height, 513);
+
+	/* stream on does not swap the format behind the link validation */
+	KUNIT_EXPECT_EQ(test, thermal_s_stream(&sensor->sd, 1), -EPIPE);
+	KUNIT_EXPECT_FALSE(test, sensor->streaming);
+	KUNIT_EXPECT_EQ(test, sensor->curr_mode.hact, 384);
+	KUNIT_EXPECT_EQ(test, sensor->fmt.height, 288);
+
+	/* userspace renegotiates */
+	KUNIT_ASSERT_EQ(test, thermal_set_fmt(&sensor->sd, NULL, &format), 0);
+	KUNIT_EXPECT_EQ(test, sensor->curr_mode.hact, 640);
+	KUNIT_EXPECT_EQ(test, sensor->fmt.width, 640);
+	KUNIT_EXPECT_EQ(test, sensor->fmt.height, 513);
+}
+
+static void thermal_test_pixel_rate(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_DEV_T* sensor = &tt->sensor;
+	int fr;
+
+	for (fr = 0; fr < TVDO_NUM_FRAMERATES; fr++) {
+		sensor->curr_fr = fr;
+		KUNIT_EXPECT_EQ(test, thermal_calc_pixel_rate(sensor), 384ULL * 288 * g_tvdo_fps[fr]);
+	}
+
+	sensor->curr_fr = TVDO_30_FPS;
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl_int64(sensor->ctrls.pixel_rate), 384LL * 288 * 30);
+}
+
+/*
+ * Controls
+ */
+static void thermal_test_ctrl_setup(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+
+	/* every writable control needs a case in thermal_s_ctrl() */
+	thermal_test_power(tt, true);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_handler_setup(&tt->sensor.ctrls.handler), 0);
+
+	tt->sensor.streaming = true;
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_handler_setup(&tt->sensor.ctrls.handler), 0);
+	tt->sensor.streaming = false;
+}
+
+static void thermal_test_ctrl_unpowered(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->test_pattern, 3), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->decimation, 2), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_width, 100), 0);
+	KUNIT_EXPECT_EQ(test, tt->xfers, 0);
+
+	/* cached for power up */
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->test_pattern), 3);
+
+	/* applied on power up */
+	thermal_test_power(tt, true);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_handler_setup(&ctrls->handler), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_TEST_PATTERN], 3 | TVDO_TEST_PATTERN_STAMP);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_FRAME_DECIM], 2);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_W], 100);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_H], 288);
+}
+
+static void thermal_test_ctrl_test_pattern(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+	int i;
+
+	thermal_test_power(tt, true);
+
+	for (i = ARRAY_SIZE(g_tvdo_test_pattern_menu) - 1; i >= 0; i--) {
+		KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->test_pattern, i), 0);
+		KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_TEST_PATTERN],
+				i ? i | TVDO_TEST_PATTERN_STAMP : 0);
+	}
+
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->test_pattern,
+					      ARRAY_SIZE(g_tvdo_test_pattern_menu)), -ERANGE);
+}
+
+static void thermal_test_ctrl_exposure(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+
+	thermal_test_power(tt, true);
+
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->auto_exp, V4L2_EXPOSURE_MANUAL), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_INT_MODE], 0);
+
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->exposure, 1000), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_INT_TIME], 1000);
+
+	/* clamped to the 30 fps frame period */
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->exposure, 50000), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->exposure),
+			USEC_PER_SEC / 30 - TVDO_INT_TIME_MARGIN_US);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_INT_TIME],
+			USEC_PER_SEC / 30 - TVDO_INT_TIME_MARGIN_US);
+
+	/* decimation drops frames after the core, the range stays */
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->decimation, 4), 0);
+	KUNIT_EXPECT_EQ(test, ctrls->exposure->maximum, USEC_PER_SEC / 30 - TVDO_INT_TIME_MARGIN_US);
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->exposure, 50000), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->exposure),
+			USEC_PER_SEC / 30 - TVDO_INT_TIME_MARGIN_US);
+
+	/* auto: the FPGA owns the integration time, no write */
+	tt->regs[TVDO_REG_INT_TIME] = 0;
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->auto_exp, V4L2_EXPOSURE_AUTO), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_INT_MODE], 1);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_INT_TIME], 0);
+}
+
+static void thermal_test_ctrl_agc_roi(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+
+	thermal_test_power(tt, true);
+
+	/* one control changed, the whole window is written */
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_width, 200), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_X], 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_Y], 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_W], 200);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_H], 288);
+
+	/* moving the window shrinks it to stay inside the image */
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_left, 300), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->roi_width), 384 - 300);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_X], 300);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_W], 384 - 300);
+
+	/* never below the minimum edge */
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_top, 500), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->roi_top), 288 - TVDO_AGC_ROI_MIN);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->roi_height), TVDO_AGC_ROI_MIN);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_H], TVDO_AGC_ROI_MIN);
+
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_width, 1), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_W], TVDO_AGC_ROI_MIN);
+
+	/* the window follows the active image, not the control range */
+	tt->sensor.curr_mode.hact = 256;
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_left, 0), 0);
+	KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_width, 384), 0);
+	KUNIT_EXPECT_EQ(test, tt->regs[TVDO_REG_AGC_ROI_W], 256);
+}
+
+static void thermal_test_ctrl_i2c_error(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+
+	thermal_test_power(tt, true);
+	tt->fail = -EIO;
+
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->test_pattern, 1), -EIO);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->decimation, 3), -EIO);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->roi_left, 8), -EIO);
+	KUNIT_EXPECT_NE(test, v4l2_ctrl_handler_setup(&ctrls->handler), 0);
+
+	/* a failed write does not stick */
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->test_pattern), 0);
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_g_ctrl(ctrls->roi_left), 0);
+
+	tt->fail = 0;
+	KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(ctrls->test_pattern, 1), 0);
+}
+
+static struct kunit_case thermal_test_cases[] = {
+	KUNIT_CASE(thermal_test_find_mode),
+	KUNIT_CASE(thermal_test_try_fmt),
+	KUNIT_CASE(thermal_test_enum_frame_size),
+	KUNIT_CASE(thermal_test_enum_frame_interval),
+	KUNIT_CASE_PARAM(thermal_test_s_frame_interval, thermal_test_fi_gen_params),
+	KUNIT_CASE(thermal_test_s_frame_interval_reject),
+	KUNIT_CASE(thermal_test_source_change),
+	KUNIT_CASE(thermal_test_pixel_rate),
+	KUNIT_CASE(thermal_test_ctrl_setup),
+	KUNIT_CASE(thermal_test_ctrl_unpowered),
+	KUNIT_CASE(thermal_test_ctrl_test_pattern),
+	KUNIT_CASE(thermal_test_ctrl_exposure),
+	KUNIT_CASE(thermal_test_ctrl_agc_roi),
+	KUNIT_CASE(thermal_test_ctrl_i2c_error),
+	{}
+};
+
+static struct kunit_suite thermal_test_suite = {
+	.name		= "tcam-vdo",
+	.init		= thermal_test_init,
+	.exit		= thermal_test_exit,
+	.test_cases	= thermal_test_cases,
+};
+
+/*
+ * Timing of the ioctl paths, ns per call on the fake bus. Reported only,
+ * compare runs of the same kunit.py config to spot regressions.
+ */
+#define TVDO_TEST_BENCH(test, name, stmt)								\
+	do {																\
+		u64 __t0 = ktime_get_ns();										\
+		int __i;														\
+																		\
+		for (__i = 0; __i < TVDO_TEST_BENCH_LOOPS; __i++) {				\
+			stmt;														\
+		}																\
+		kunit_info(test, "%-24s %6llu ns/op\n", name,					\
+			   div_u64(ktime_get_ns() - __t0, TVDO_TEST_BENCH_LOOPS));	\
+	} while (0)
+
+static void thermal_test_bench_pad(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	struct v4l2_subdev* sd = &tt->sensor.sd;
+	struct v4l2_subdev_frame_size_enum fse = {
+		.code = g_tvdo_pixfmt[0].code,
+	};
+	struct v4l2_subdev_frame_interval_enum fie = {
+		.code	= g_tvdo_pixfmt[0].code,
+		.width	= 384,
+		.height	= 288,
+	};
+	struct v4l2_subdev_frame_interval fi = {
+		.interval = { 1, 15 },
+	};
+	struct v4l2_mbus_framefmt fmt = {
+		.width	= 384,
+		.height	= 288,
+	};
+
+	TVDO_TEST_BENCH(test, "enum_frame_size", thermal_enum_frame_size(sd, NULL, &fse));
+	TVDO_TEST_BENCH(test, "enum_frame_interval",
+			fie.index = __i % ARRAY_SIZE(g_tvdo_decim);
+			thermal_enum_frame_interval(sd, NULL, &fie));
+	TVDO_TEST_BENCH(test, "try_fmt", thermal_try_fmt_internal(sd, &fmt, TVDO_30_FPS, NULL));
+	TVDO_TEST_BENCH(test, "g_frame_interval", thermal_g_frame_interval(sd, NULL, &fi));
+
+	/* unpowered: control core only, powered: plus one register write */
+	TVDO_TEST_BENCH(test, "s_frame_interval",
+			fi.interval.numerator = 1 + (__i & 1);
+			fi.interval.denominator = 30;
+			thermal_s_frame_interval(sd, NULL, &fi));
+	thermal_test_power(tt, true);
+	TVDO_TEST_BENCH(test, "s_frame_interval (hw)",
+			fi.interval.numerator = 1 + (__i & 1);
+			fi.interval.denominator = 30;
+			thermal_s_frame_interval(sd, NULL, &fi));
+
+	KUNIT_EXPECT_EQ(test, tt->fail, 0);
+}
+
+static void thermal_test_bench_ctrl(struct kunit *test)
+{
+	TVDO_TEST_T* tt = test->priv;
+	TVDO_CTRLS_T* ctrls = &tt->sensor.ctrls;
+
+	TVDO_TEST_BENCH(test, "s_ctrl", v4l2_ctrl_s_ctrl(ctrls->test_pattern, 1 + (__i & 1)));
+	TVDO_TEST_BENCH(test, "g_ctrl", v4l2_ctrl_g_ctrl(ctrls->test_pattern));
+
+	thermal_test_power(tt, true);
+	TVDO_TEST_BENCH(test, "s_ctrl (hw)", v4l2_ctrl_s_ctrl(ctrls->test_pattern, 1 + (__i & 1)));
+	TVDO_TEST_BENCH(test, "agc roi cluster (hw)",
+			v4l2_ctrl_s_ctrl(ctrls->roi_width, 100 + (__i & 1)));
+	TVDO_TEST_BENCH(test, "ctrl_handler_setup (hw)", v4l2_ctrl_handler_setup(&ctrls->handler));
+
+	KUNIT_EXPECT_EQ(test, tt->fail, 0);
+}
+
+static struct kunit_case thermal_test_bench_cases[] = {
+	KUNIT_CASE_SLOW(thermal_test_bench_pad),
+	KUNIT_CASE_SLOW(thermal_test_bench_ctrl),
+	{}
+};
+
+static struct kunit_suite thermal_test_bench_suite = {
+	.name		= "tcam-vdo-bench",
+	.init		= thermal_test_init,
+	.exit		= thermal_test_exit,
+	.test_cases	= thermal_test_bench_cases,
+};
+
+kunit_test_suites(&thermal_test_suite, &thermal_test_bench_suite);
@@ -0,0 +1,661 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Virtual COX LWIR sensor, a vivid-style capture node producing the
+ * frames the real pipeline delivers, for userspace development and load
+ * tests without a camera.
+ *
+ *   role=raw : 384x289 UYVY. 384x288 14 bit pixels, MSB first in each
+ *              16 bit sample, followed by one telemetry line.
+ *   role=vdo : 384x288 YUYV, AGC applied, chroma flat.
+ *
+ * Pixel 0 carries the 16 bit frame counter (as with the FPGA frame stamp)
+ * and the buffer sequence matches it, so drops are visible in both.
+ *
+ * Telemetry line (raw), big endian words:
+ *   [0] layout version (1)     [1] frame counter
+ *   [2] FPA temp (0.01 K)      [3] FPGA temp (0.01 K)
+ *   [4] FFC count              [5] integration time (us)
+ *   [6] hottest pixel          [7] coldest pixel
+ *   rest zero
+ *
+ * Copyright (C).
+ */
+
+#include <linux/delay.h>
+#include <linux/freezer.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/videodev2.h>
+
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
+#include <media/v4l2-fh.h>
+#include <media/v4l2-ioctl.h>
+#include <media/videobuf2-vmalloc.h>
+
+
+//#define		TVSENDRV_DBG_MSG
+
+#define		TVSEN_WIDTH				(384)
+#define		TVSEN_HEIGHT			(288)
+#define		TVSEN_RAW_TELEMETRY		(1)			//	lines after the image
+#define		TVSEN_BPP				(2)
+
+#define		TVSEN_MAX_COUNT			(0x3fff)	//	14 bit ADC
+#define		TVSEN_BG_COUNT			(7000)		//	room background
+#define		TVSEN_BLOB_COUNT		(5000)		//	hot object above background
+#define		TVSEN_BLOB_RADIUS		(28)
+
+#define		TVSEN_TELEMETRY_VER		(1)
+#define		TVSEN_FPA_CK			(30315)
+#define		TVSEN_FPGA_CK			(31815)
+#define		TVSEN_INT_TIME_US		(8000)
+#define		TVSEN_FFC_PERIOD_S		(180)
+
+#define		TVSEN_RAW_FPS			(60)		//	tcam-raw core rate
+#define		TVSEN_VDO_FPS			(30)		//	tcam-vdo core rate
+
+/*
+ * Output 1 of N core frames, as the FPGA decimation. Same intervals the
+ * subdevs enumerate: 60, 30, 15, 7.5 fps raw and 30, 15, 7.5 fps vdo.
+ */
+static const int	g_tvsen_decim[] = { 1, 2, 4, 8 };
+#define		TVSEN_RAW_NUM_DECIM		(4)
+#define		TVSEN_VDO_NUM_DECIM		(3)
+
+typedef struct __thermal_vsen_buffer__ {
+	struct vb2_v4l2_buffer	vb;
+	struct list_head		list;
+} TVSEN_BUF_T;
+
+typedef struct __thermal_vsen_dev__ {
+	struct platform_device*	pdev;
+	struct v4l2_device		v4l2_dev;
+	struct video_device		vdev;
+	struct vb2_queue		queue;
+
+	struct mutex			lock;			//	ioctl / vb2 queue
+	spinlock_t				slock;			//	buf_list
+	struct list_head		buf_list;
+
+	struct task_struct*		kthread;
+
+	bool					raw;
+	struct v4l2_pix_format	fmt;
+	int						core_fps;
+	int						num_decim;		//	entries of g_tvsen_decim offered
+	int						curr_decim;		//	g_tvsen_decim index
+
+	u32						sequence;
+	u32						drop_cnt;
+	u16						frame_min;
+	u16						frame_max;
+} TVSEN_DEV_T;
+
+
+static char *role = "raw";
+module_param(role, charp, 0444);
+MODULE_PARM_DESC(role, "Emulated camera: raw (UYVY 384x289) or vdo (YUYV 384x288), default raw");
+
+static unsigned int decim = 1;
+module_param(decim, uint, 0444);
+MODULE_PARM_DESC(decim, "Initial frame decimation, 1 of N core frames (1, 2, 4, 8 raw / 1, 2, 4 vdo), default 1");
+
+
+static TVSEN_DEV_T*	g_tvsen_dev;
+
+
+static inline TVSEN_BUF_T* to_tvsen_buf(struct vb2_v4l2_buffer *vbuf)
+{
+	return container_of(vbuf, TVSEN_BUF_T, vb);
+}
+
+static unsigned int tvsen_interval_us(TVSEN_DEV_T* dev)
+{
+	return USEC_PER_SEC * g_tvsen_decim[dev->curr_decim] / dev->core_fps;
+}
+
+/*
+ * Synthetic scene: a tilted background with a hot blob bouncing across
+ * it. Everything is derived from the sequence number so a given frame is
+ * identical from run to run.
+ */
+static u16 tvsen_scene(TVSEN_DEV_T* dev, int x, int y, int cx, int cy)
+{
+	int		dx = x - cx;
+	int		dy = y - cy;
+	int		d2 = dx * dx + dy * dy;
+	int		r2 = TVSEN_BLOB_RADIUS * TVSEN_BLOB_RADIUS;
+	int		v;
+
+	v = TVSEN_BG_COUNT + x * 2 + y * 3;
+	if ( d2 < r2 )
+		v += TVSEN_BLOB_COUNT * (r2 - d2) / r2;
+
+	//	고정 패턴 노이즈 흉내 (결정적)
+	v += ((x * 7 + y * 13) & 0xf) - 8;
+
+	return clamp(v, 0, TVSEN_MAX_COUNT);
+}
+
+static void tvsen_blob_pos(TVSEN_DEV_T* dev, int *cx, int *cy)
+{
+	int		span_x = 2 * (TVSEN_WIDTH - 1);
+	int		span_y = 2 * (TVSEN_HEIGHT - 1);
+	int		px = (dev->sequence * 3) % span_x;
+	int		py = (dev->sequence * 2) % span_y;
+
+	//	triangle wave, bounce off the edges
+	*cx = px < TVSEN_WIDTH ? px : span_x - px;
+	*cy = py < TVSEN_HEIGHT ? py : span_y - py;
+}
+
+static void tvsen_put_be16(u8 *p, u16 v)
+{
+	p[0] = v >> 8;
+	p[1] = v & 0xff;
+}
+
+static void tvsen_fill_raw(TVSEN_DEV_T* dev, u8 *vbuf)
+{
+	u8		*line;
+	u16		v;
+	int		x, y, cx, cy;
+
+	tvsen_blob_pos(dev, &cx, &cy);
+
+	dev->frame_min = TVSEN_MAX_COUNT;
+	dev->frame_max = 0;
+
+	for ( y = 0; y < TVSEN_HEIGHT; y++ ) {
+		line = vbuf + y * dev->fmt.bytesperline;
+		for ( x = 0; x < TVSEN_WIDTH; x++ ) {
+			v = tvsen_scene(dev, x, y, cx, cy);
+			dev->frame_min = min(dev->frame_min, v);
+			dev->frame_max = max(dev->frame_max, v);
+			tvsen_put_be16(line + x * TVSEN_BPP, v);
+		}
+	}
+
+	line = vbuf + TVSEN_HEIGHT * dev->fmt.bytesperline;
+	memset(line, 0, dev->fmt.bytesperline);
+	tvsen_put_be16(line +  0, TVSEN_TELEMETRY_VER);
+	tvsen_put_be16(line +  2, (u16)dev->sequence);
+	tvsen_put_be16(line +  4, TVSEN_FPA_CK);
+	tvsen_put_be16(line +  6, TVSEN_FPGA_CK);
+	tvsen_put_be16(line +  8, div_u64((u64)dev->sequence * tvsen_interval_us(dev),
+					  TVSEN_FFC_PERIOD_S * USEC_PER_SEC));
+	tvsen_put_be16(line + 10, TVSEN_INT_TIME_US);
+	tvsen_put_be16(line + 12, dev->frame_max);
+	tvsen_put_be16(line + 14, dev->frame_min);
+}
+
+static void tvsen_fill_vdo(TVSEN_DEV_T* dev, u8 *vbuf)
+{
+	const int	lo = TVSEN_BG_COUNT;
+	const int	span = TVSEN_WIDTH * 2 + TVSEN_HEIGHT * 3 + TVSEN_BLOB_COUNT;
+	u8		*line;
+	int		x, y, cx, cy, v;
+
+	tvsen_blob_pos(dev, &cx, &cy);
+
+	//	fixed linear AGC over the known scene range, limited range luma
+	for ( y = 0; y < TVSEN_HEIGHT; y++ ) {
+		line = vbuf + y * dev->fmt.bytesperline;
+		for ( x = 0; x < TVSEN_WIDTH; x++ ) {
+			v = tvsen_scene(dev, x, y, cx, cy) - lo;
+			line[x * 2 + 0] = 16 + clamp(v, 0, span) * 219 / span;
+			line[x * 2 + 1] = 128;
+		}
+	}
+}
+
+static void tvsen_fill_buf(TVSEN_DEV_T* dev, TVSEN_BUF_T* buf)
+{
+	u8		*vbuf = vb2_plane_vaddr(&buf->vb.vb2_buf, 0);
+
+	if ( dev->raw )
+		tvsen_fill_raw(dev, vbuf);
+	else
+		tvsen_fill_vdo(dev, vbuf);
+
+	//	frame stamp
+	tvsen_put_be16(vbuf, (u16)dev->sequence);
+
+	buf->vb.sequence		= dev->sequence;
+	buf->vb.field			= V4L2_FIELD_NONE;
+	buf->vb.vb2_buf.timestamp	= ktime_get_ns();
+}
+
+static int tvsen_thread(void *data)
+{
+	TVSEN_DEV_T* dev = data;
+	TVSEN_BUF_T* buf;
+	ktime_t		next = ktime_get();
+	s64			wait_us;
+	unsigned long	flags;
+
+	set_freezable();
+
+	while ( !kthread_should_stop() ) {
+		try_to_freeze();
+
+		spin_lock_irqsave(&dev->slock, flags);
+		buf = list_first_entry_or_null(&dev->buf_list, TVSEN_BUF_T, list);
+		if ( buf )
+			list_del(&buf->list);
+		spin_unlock_irqrestore(&dev->slock, flags);
+
+		if ( buf ) {
+			tvsen_fill_buf(dev, buf);
+			vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+		}
+		else {
+			//	userspace 가 버퍼를 늦게 돌려주면 실제 센서처럼 프레임을 버린다
+			dev->drop_cnt++;
+		}
+
+		dev->sequence++;
+
+		//	absolute deadline, no drift from fill time
+		next = ktime_add_us(next, tvsen_interval_us(dev));
+		wait_us = ktime_us_delta(next, ktime_get());
+		if ( wait_us > 0 )
+			usleep_range(wait_us, wait_us + 100);
+		else
+			next = ktime_get();
+	}
+
+	return 0;
+}
+
+static void tvsen_return_all(TVSEN_DEV_T* dev, enum vb2_buffer_state state)
+{
+	TVSEN_BUF_T *buf, *tmp;
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->slock, flags);
+	list_for_each_entry_safe(buf, tmp, &dev->buf_list, list) {
+		list_del(&buf->list);
+		vb2_buffer_done(&buf->vb.vb2_buf, state);
+	}
+	spin_unlock_irqrestore(&dev->slock, flags);
+}
+
+static int tvsen_queue_setup(struct vb2_queue *vq,
+			     unsigned int *nbuffers, unsigned int *nplanes,
+			     unsigned int sizes[], struct device *alloc_devs[])
+{
+	TVSEN_DEV_T* dev = vb2_get_drv_priv(vq);
+
+	if ( *nplanes )
+		return sizes[0] < dev->fmt.sizeimage ? -EINVAL : 0;
+
+	*nplanes = 1;
+	sizes[0] = dev->fmt.sizeimage;
+
+	return 0;
+}
+
+static int tvsen_buf_prepare(struct vb2_buffer *vb)
+{
+	TVSEN_DEV_T* dev = vb2_get_drv_priv(vb->vb2_queue);
+
+	if ( vb2_plane_size(vb, 0) < dev->fmt.sizeimage )
+		return -EINVAL;
+
+	vb2_set_plane_payload(vb, 0, dev->fmt.sizeimage);
+
+	return 0;
+}
+
+static void tvsen_buf_queue(struct vb2_buffer *vb)
+{
+	TVSEN_DEV_T* dev = vb2_get_drv_priv(vb->vb2_queue);
+	TVSEN_BUF_T* buf = to_tvsen_buf(to_vb2_v4l2_buffer(vb));
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->slock, flags);
+	list_add_tail(&buf->list, &dev->buf_list);
+	spin_unlock_irqrestore(&dev->slock, flags);
+}
+
+static int tvsen_start_streaming(struct vb2_queue *vq, unsigned int count)
+{
+	TVSEN_DEV_T* dev = vb2_get_drv_priv(vq);
+
+	dev->sequence	= 0;
+	dev->drop_cnt	= 0;
+
+	dev->kthread = kthread_run(tvsen_thread, dev, "%s", dev->v4l2_dev.name);
+	if ( IS_ERR(dev->kthread) ) {
+		int ret = PTR_ERR(dev->kthread);
+
+		dev->kthread = NULL;
+		tvsen_return_all(dev, VB2_BUF_STATE_QUEUED);
+		return ret;
+	}
+
+	return 0;
+}
+
+static void tvsen_stop_streaming(struct vb2_queue *vq)
+{
+	TVSEN_DEV_T* dev = vb2_get_drv_priv(vq);
+
+	if ( dev->kthread ) {
+		kthread_stop(dev->kthread);
+		dev->kthread = NULL;
+	}
+
+	tvsen_return_all(dev, VB2_BUF_STATE_ERROR);
+
+	#ifdef TVSENDRV_DBG_MSG
+	printk(KERN_INFO "tvsen: %u frames, %u dropped\n", dev->sequence, dev->drop_cnt);
+	#endif
+}
+
+static const struct vb2_ops tvsen_qops = {
+	.queue_setup		= tvsen_queue_setup,
+	.buf_prepare		= tvsen_buf_prepare,
+	.buf_queue			= tvsen_buf_queue,
+	.start_streaming	= tvsen_start_streaming,
+	.stop_streaming		= tvsen_stop_streaming,
+	.wait_prepare		= vb2_ops_wait_prepare,
+	.wait_finish		= vb2_ops_wait_finish,
+};
+
+static int tvsen_querycap(struct file *file, void *priv,
+			  struct v4l2_capability *cap)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	strscpy(cap->driver, "tcam-vsen", sizeof(cap->driver));
+	strscpy(cap->card, dev->v4l2_dev.name, sizeof(cap->card));
+	snprintf(cap->bus_info, sizeof(cap->bus_info), "platform:%s",
+		 dev_name(&dev->pdev->dev));
+
+	return 0;
+}
+
+static int tvsen_enum_fmt(struct file *file, void *priv,
+			  struct v4l2_fmtdesc *f)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	if ( f->index > 0 )
+		return -EINVAL;
+
+	f->pixelformat = dev->fmt.pixelformat;
+
+	return 0;
+}
+
+//	포맷은 역할에 따라 고정
+static int tvsen_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	f->fmt.pix = dev->fmt;
+
+	return 0;
+}
+
+static int tvsen_s_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	if ( vb2_is_busy(&dev->queue) )
+		return -EBUSY;
+
+	return tvsen_fmt(file, priv, f);
+}
+
+static int tvsen_enum_framesizes(struct file *file, void *priv,
+				 struct v4l2_frmsizeenum *fsize)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	if ( fsize->index > 0 || fsize->pixel_format != dev->fmt.pixelformat )
+		return -EINVAL;
+
+	fsize->type				= V4L2_FRMSIZE_TYPE_DISCRETE;
+	fsize->discrete.width	= dev->fmt.width;
+	fsize->discrete.height	= dev->fmt.height;
+
+	return 0;
+}
+
+static int tvsen_enum_frameintervals(struct file *file, void *priv,
+				     struct v4l2_frmivalenum *fival)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	if ( fival->index >= dev->num_decim ||
+	     fival->pixel_format != dev->fmt.pixelformat ||
+	     fival->width != dev->fmt.width ||
+	     fival->height != dev->fmt.height )
+		return -EINVAL;
+
+	fival->type					= V4L2_FRMIVAL_TYPE_DISCRETE;
+	fival->discrete.numerator	= g_tvsen_decim[fival->index];
+	fival->discrete.denominator	= dev->core_fps;
+
+	return 0;
+}
+
+static int tvsen_g_parm(struct file *file, void *priv,
+			struct v4l2_streamparm *parm)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+
+	if ( parm->type != V4L2_BUF_TYPE_VIDEO_CAPTURE )
+		return -EINVAL;
+
+	parm->parm.capture.capability	= V4L2_CAP_TIMEPERFRAME;
+	parm->parm.capture.readbuffers	= 1;
+	parm->parm.capture.timeperframe.numerator	= g_tvsen_decim[dev->curr_decim];
+	parm->parm.capture.timeperframe.denominator	= dev->core_fps;
+
+	return 0;
+}
+
+//	가장 가까운 지원 frame interval 선택
+static int tvsen_s_parm(struct file *file, void *priv,
+			struct v4l2_streamparm *parm)
+{
+	TVSEN_DEV_T* dev = video_drvdata(file);
+	struct v4l2_fract *tpf = &parm->parm.capture.timeperframe;
+	s64		err, best = S64_MAX;
+	int		i;
+
+	if ( parm->type != V4L2_BUF_TYPE_VIDEO_CAPTURE )
+		return -EINVAL;
+
+	if ( tpf->numerator && tpf->denominator ) {
+		//	|decim / core_fps - num / den| scaled by core_fps * den
+		for ( i = 0; i < dev->num_decim; i++ ) {
+			err = abs((s64)g_tvsen_decim[i] * tpf->denominator -
+				  (s64)tpf->numerator * dev->core_fps);
+			if ( err < best ) {
+				best = err;
+				dev->curr_decim = i;
+			}
+		}
+	}
+
+	return tvsen_g_parm(file, priv, parm);
+}
+
+static const struct v4l2_ioctl_ops tvsen_ioctl_ops = {
+	.vidioc_querycap				= tvsen_querycap,
+	.vidioc_enum_fmt_vid_cap		= tvsen_enum_fmt,
+	.vidioc_g_fmt_vid_cap			= tvsen_fmt,
+	.vidioc_try_fmt_vid_cap			= tvsen_fmt,
+	.vidioc_s_fmt_vid_cap			= tvsen_s_fmt,
+	.vidioc_enum_framesizes			= tvsen_enum_framesizes,
+	.vidioc_enum_frameintervals		= tvsen_enum_frameintervals,
+	.vidioc_g_parm					= tvsen_g_parm,
+	.vidioc_s_parm					= tvsen_s_parm,
+
+	.vidioc_reqbufs					= vb2_ioctl_reqbufs,
+	.vidioc_create_bufs				= vb2_ioctl_create_bufs,
+	.vidioc_prepare_buf				= vb2_ioctl_prepare_buf,
+	.vidioc_querybuf				= vb2_ioctl_querybuf,
+	.vidioc_qbuf					= vb2_ioctl_qbuf,
+	.vidioc_dqbuf					= vb2_ioctl_dqbuf,
+	.vidioc_expbuf					= vb2_ioctl_expbuf,
+	.vidioc_streamon				= vb2_ioctl_streamon,
+	.vidioc_streamoff				= vb2_ioctl_streamoff,
+
+	.vidioc_log_status				= v4l2_ctrl_log_status,
+	.vidioc_subscribe_event			= v4l2_ctrl_subscribe_event,
+	.vidioc_unsubscribe_event		= v4l2_event_unsubscribe,
+};
+
+static const struct v4l2_file_operations tvsen_fops = {
+	.owner			= THIS_MODULE,
+	.open			= v4l2_fh_open,
+	.release		= vb2_fop_release,
+	.read			= vb2_fop_read,
+	.poll			= vb2_fop_poll,
+	.mmap			= vb2_fop_mmap,
+	.unlocked_ioctl	= video_ioctl2,
+};
+
+static void tvsen_init_fmt(TVSEN_DEV_T* dev)
+{
+	struct v4l2_pix_format *pix = &dev->fmt;
+
+	pix->width			= TVSEN_WIDTH;
+	pix->height			= TVSEN_HEIGHT + (dev->raw ? TVSEN_RAW_TELEMETRY : 0);
+	pix->pixelformat	= dev->raw ? V4L2_PIX_FMT_UYVY : V4L2_PIX_FMT_YUYV;
+	pix->field			= V4L2_FIELD_NONE;
+	pix->bytesperline	= pix->width * TVSEN_BPP;
+	pix->sizeimage		= pix->bytesperline * pix->height;
+	pix->colorspace		= dev->raw ? V4L2_COLORSPACE_RAW : V4L2_COLORSPACE_SRGB;
+	pix->quantization	= dev->raw ? V4L2_QUANTIZATION_FULL_RANGE : V4L2_QUANTIZATION_LIM_RANGE;
+}
+
+static int __init tvsen_init(void)
+{
+	TVSEN_DEV_T* dev;
+	struct vb2_queue *q;
+	int		ret, i;
+
+	dev = kzalloc(sizeof(*dev), GFP_KERNEL);
+	if ( NULL == dev )
+		return -ENOMEM;
+
+	if ( sysfs_streq(role, "raw") ) {
+		dev->raw = true;
+	}
+	else if ( !sysfs_streq(role, "vdo") ) {
+		pr_err("tcam-vsen: invalid role '%s'\n", role);
+		ret = -EINVAL;
+		goto free_dev;
+	}
+
+	dev->core_fps	= dev->raw ? TVSEN_RAW_FPS : TVSEN_VDO_FPS;
+	dev->num_decim	= dev->raw ? TVSEN_RAW_NUM_DECIM : TVSEN_VDO_NUM_DECIM;
+	for ( i = 0; i < dev->num_decim; i++ ) {
+		if ( (unsigned int)g_tvsen_decim[i] == decim )
+			break;
+	}
+	if ( i == dev->num_decim ) {
+		pr_err("tcam-vsen: decim %u not offered for role %s\n", decim, role);
+		ret = -EINVAL;
+		goto free_dev;
+	}
+	dev->curr_decim = i;
+
+	tvsen_init_fmt(dev);
+	mutex_init(&dev->lock);
+	spin_lock_init(&dev->slock);
+	INIT_LIST_HEAD(&dev->buf_list);
+
+	dev->pdev = platform_device_register_simple("tcam-vsen", -1, NULL, 0);
+	if ( IS_ERR(dev->pdev) ) {
+		ret = PTR_ERR(dev->pdev);
+		goto free_dev;
+	}
+
+	snprintf(dev->v4l2_dev.name, sizeof(dev->v4l2_dev.name),
+		 "tcam-vsen %s", dev->raw ? "traw" : "tvdo");
+	ret = v4l2_device_register(&dev->pdev->dev, &dev->v4l2_dev);
+	if ( ret )
+		goto unregister_pdev;
+
+	q = &dev->queue;
+	q->type				= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	q->io_modes			= VB2_MMAP | VB2_USERPTR | VB2_DMABUF | VB2_READ;
+	q->drv_priv			= dev;
+	q->buf_struct_size	= sizeof(TVSEN_BUF_T);
+	q->ops				= &tvsen_qops;
+	q->mem_ops			= &vb2_vmalloc_memops;
+	q->timestamp_flags	= V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	q->min_queued_buffers	= 1;
+	q->lock				= &dev->lock;
+	q->dev				= &dev->pdev->dev;
+
+	ret = vb2_queue_init(q);
+	if ( ret )
+		goto unregister_v4l2;
+
+	strscpy(dev->vdev.name, dev->v4l2_dev.name, sizeof(dev->vdev.name));
+	dev->vdev.fops			= &tvsen_fops;
+	dev->vdev.ioctl_ops		= &tvsen_ioctl_ops;
+	dev->vdev.release		= video_device_release_empty;
+	dev->vdev.v4l2_dev		= &dev->v4l2_dev;
+	dev->vdev.queue			= q;
+	dev->vdev.lock			= &dev->lock;
+	dev->vdev.device_caps	= V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING |
+							  V4L2_CAP_READWRITE;
+	video_set_drvdata(&dev->vdev, dev);
+
+	ret = video_register_device(&dev->vdev, VFL_TYPE_VIDEO, -1);
+	if ( ret )
+		goto unregister_v4l2;
+
+	g_tvsen_dev = dev;
+
+	printk(KERN_INFO "tcam-vsen: %s as %s, %ux%u @ %d/%d fps\n",
+	       dev->v4l2_dev.name, video_device_node_name(&dev->vdev),
+	       dev->fmt.width, dev->fmt.height, dev->core_fps,
+	       g_tvsen_decim[dev->curr_decim]);
+
+	return 0;
+
+unregister_v4l2:
+	v4l2_device_unregister(&dev->v4l2_dev);
+unregister_pdev:
+	platform_device_unregister(dev->pdev);
+free_dev:
+	kfree(dev);
+
+	return ret;
+}
+
+static void __exit tvsen_exit(void)
+{
+	TVSEN_DEV_T* dev = g_tvsen_dev;
+
+	vb2_video_unregister_device(&dev->vdev);
+	v4l2_device_unregister(&dev->v4l2_dev);
+	platform_device_unregister(dev->pdev);
+	mutex_destroy(&dev->lock);
+	kfree(dev);
+}
+
+module_init(tvsen_init);
+module_exit(tvsen_exit);
+
+MODULE_AUTHOR("COX Co.Ltd <csi@coxcamera.com>");
+MODULE_DESCRIPTION("COX LWIR virtual sensor");
+MODULE_LICENSE("GPL v2");
@@ -149,6 +149,34 @@ check_kernel_version;
 check_i2c_bus;
 echo ""
 
+# native setup tool (app_src), the media-ctl sequence below is the fallback
+TCAM_MEDIA_SETUP=$(command -v tcam-media-setup || echo "$(dirname "$0")/../app_src/tcam-media-setup")
+TCAM_ENV_FILE="$HOME/.tcam_env"
+
+if [ -x "$TCAM_MEDIA_SETUP" ]; then
+    tcam_env_new=$(mktemp) || exit 1
+    trap 'rm -f "$tcam_env_new"' EXIT
+
+    "$TCAM_MEDIA_SETUP" -v -R $I2CBUS_CAM0 -V $I2CBUS_CAM1 -o "$tcam_env_new" $1 || exit $?
+
+    # a single camera run only replaces its own entries, keep the other camera's
+    if [ -f "$TCAM_ENV_FILE" ]; then
+        tcam_env_keys=$(sed -n 's/^\(export [A-Za-z0-9_]*=\).*/\1/p' "$tcam_env_new")
+        if [ -n "$tcam_env_keys" ]; then
+            grep -vF "$tcam_env_keys" "$TCAM_ENV_FILE" >> "$tcam_env_new"
+        else
+            cat "$TCAM_ENV_FILE" >> "$tcam_env_new"
+        fi
+    fi
+    cat "$tcam_env_new" > "$TCAM_ENV_FILE" || exit $?
+
+    # one line in ~/.bashrc, device paths live in $TCAM_ENV_FILE
+    grep -qF "$TCAM_ENV_FILE" ~/.bashrc || echo "[ -f $TCAM_ENV_FILE ] && . $TCAM_ENV_FILE" >> ~/.bashrc
+
+    echo "================ Thermal Camera Module Setting Finish ================"
+    exit 0
+fi
+
 valid_drivers=("tcam-vdo" "tcam-raw")
 
 if [ $# -eq 0 ]; then
@@ -0,0 +1,210 @@
+#!/bin/bash
+
+# Switch the thermal camera configuration at runtime, without editing
+# config.txt or rebooting.
+#
+#   sudo bash switch_tcam_mode.sh <tcam-vdo|tcam-raw|both|off> [overlay params]
+#
+# Overlays are applied through the configfs device-tree overlay interface
+# (the dtoverlay utility when present, so overlay parameters work), the
+# matching module is loaded and the media pipeline is configured with
+# tcam-media-setup.
+# Cameras already set up with dtoverlay= in config.txt cannot be removed
+# at runtime, uninstall them first.
+
+CONFIGFS_OVERLAYS="/sys/kernel/config/device-tree/overlays"
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+DRVBIN_DIR="$SCRIPT_DIR/drv_bin/$(uname -r)"
+
+# seconds to wait for the sensor to probe after the overlay is applied
+PROBE_TIMEOUT=5
+
+# module / i2c driver / overlay per camera
+declare -A TCAM_I2C_DRV=( ["tcam-vdo"]="tvdo" ["tcam-raw"]="traw" )
+declare -A TCAM_MODULE=( ["tcam-vdo"]="tcam_vdo" ["tcam-raw"]="tcam_raw" )
+
+usage()
+{
+    echo "usage: $0 <tcam-vdo|tcam-raw|both|off> [overlay params, e.g. reset-gpio=5]"
+    exit 1
+}
+
+if [ $# -lt 1 ]; then
+    usage
+fi
+
+case "$1" in
+"tcam-vdo") targets=("tcam-vdo") ;;
+"tcam-raw") targets=("tcam-raw") ;;
+"both")     targets=("tcam-vdo" "tcam-raw") ;;
+"off")      targets=() ;;
+*)          usage ;;
+esac
+shift
+overlay_params=("$@")
+
+if [ "$(id -u)" -ne 0 ]; then
+    echo "Please run as root."
+    exit 1
+fi
+
+if [ ! -d "$CONFIGFS_OVERLAYS" ]; then
+    mount -t configfs none /sys/kernel/config 2>/dev/null
+    if [ ! -d "$CONFIGFS_OVERLAYS" ]; then
+        echo "Kernel has no configfs device-tree overlay support."
+        exit 1
+    fi
+fi
+
+is_target()
+{
+    local name
+    for name in "${targets[@]}"; do
+        [ "$name" == "$1" ] && return 0
+    done
+    return 1
+}
+
+overlay_applied()
+{
+    if command -v dtoverlay >/dev/null; then
+        dtoverlay -l 2>/dev/null | grep -qw "$1"
+    else
+        [ -d "$CONFIGFS_OVERLAYS/$1" ]
+    fi
+}
+
+find_dtbo()
+{
+    if [ -f "/boot/overlays/$1.dtbo" ]; then
+        echo "/boot/overlays/$1.dtbo"
+    elif [ -f "$DRVBIN_DIR/$1.dtbo" ]; then
+        echo "$DRVBIN_DIR/$1.dtbo"
+    fi
+}
+
+load_module()
+{
+    local tcam_name="$1"
+
+    if modprobe "$tcam_name" 2>/dev/null; then
+        return 0
+    fi
+
+    # not installed, use the build output
+    if [ -f "$DRVBIN_DIR/$tcam_name.ko" ]; then
+        insmod "$DRVBIN_DIR/$tcam_name.ko" 2>/dev/null
+        lsmod | grep -qw "${TCAM_MODULE[$tcam_name]}" && return 0
+    fi
+
+    echo "Can not load $tcam_name module"
+    return 1
+}
+
+apply_overlay()
+{
+    local tcam_name="$1"
+    local dtbo
+
+    if overlay_applied "$tcam_name"; then
+        echo "$tcam_name overlay already applied"
+        return 0
+    fi
+
+    if command -v dtoverlay >/dev/null && [ -f "/boot/overlays/$tcam_name.dtbo" ]; then
+        dtoverlay "$tcam_name" "${overlay_params[@]}"
+        return $?
+    fi
+
+    dtbo=$(find_dtbo "$tcam_name")
+    if [ -z "$dtbo" ]; then
+        echo "$tcam_name.dtbo not found"
+        return 1
+    fi
+
+    if [ ${#overlay_params[@]} -ne 0 ]; then
+        echo "Overlay params need the dtoverlay utility, ignored: ${overlay_params[*]}"
+    fi
+
+    mkdir "$CONFIGFS_OVERLAYS/$tcam_name" || return 1
+    cat "$dtbo" > "$CONFIGFS_OVERLAYS/$tcam_name/dtbo"
+
+    if [ "$(cat "$CONFIGFS_OVERLAYS/$tcam_name/status")" != "applied" ]; then
+        echo "$tcam_name overlay not applied"
+        rmdir "$CONFIGFS_OVERLAYS/$tcam_name"
+        return 1
+    fi
+
+    return 0
+}
+
+remove_camera()
+{
+    local tcam_name="$1"
+    local i2c_drv="${TCAM_I2C_DRV[$tcam_name]}"
+    local dev
+
+    echo "--------------------------------------"
+    echo "Remove $tcam_name"
+
+    # unbind first so streaming users get an error instead of a stall
+    for dev in /sys/bus/i2c/drivers/$i2c_drv/*-0054; do
+        [ -e "$dev" ] && echo "$(basename "$dev")" > "/sys/bus/i2c/drivers/$i2c_drv/unbind"
+    done
+
+    if command -v dtoverlay >/dev/null && dtoverlay -l 2>/dev/null | grep -qw "$tcam_name"; then
+        dtoverlay -r "$tcam_name"
+    elif [ -d "$CONFIGFS_OVERLAYS/$tcam_name" ]; then
+        rmdir "$CONFIGFS_OVERLAYS/$tcam_name"
+    fi
+
+    modprobe -r "${TCAM_MODULE[$tcam_name]}" 2>/dev/null || \
+        rmmod "${TCAM_MODULE[$tcam_name]}" 2>/dev/null
+}
+
+add_camera()
+{
+    local tcam_name="$1"
+    local i2c_drv="${TCAM_I2C_DRV[$tcam_name]}"
+    local wait_cnt
+
+    echo "--------------------------------------"
+    echo "Add $tcam_name"
+
+    load_module "$tcam_name" || return 1
+    apply_overlay "$tcam_name" || return 1
+
+    # FPGA detection runs in probe, wait for the bound client
+    for ((wait_cnt = 0; wait_cnt < PROBE_TIMEOUT * 10; wait_cnt++)); do
+        ls /sys/bus/i2c/drivers/$i2c_drv/*-0054 >/dev/null 2>&1 && return 0
+        sleep 0.1
+    done
+
+    echo "$tcam_name did not probe, check dmesg"
+    return 1
+}
+
+echo ""
+echo "================ Thermal Camera Mode Switch ================"
+
+for tcam_name in "tcam-vdo" "tcam-raw"; do
+    if ! is_target "$tcam_name"; then
+        if overlay_applied "$tcam_name" || lsmod | grep -qw "${TCAM_MODULE[$tcam_name]}"; then
+            remove_camera "$tcam_name"
+        fi
+    fi
+done
+
+result=0
+for tcam_name in "${targets[@]}"; do
+    add_camera "$tcam_name" || result=1
+done
+
+if [ ${#targets[@]} -ne 0 ]; then
+    echo "--------------------------------------"
+    sudo -H -u "${SUDO_USER:-root}" bash "$SCRIPT_DIR/media_setting_rpi5.sh"
+fi
+
+echo "================ Thermal Camera Mode Switch Finish ================"
+
+exit $result
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Plateau histogram equalization AGC, see tcam_agc.h.
+ *
+ * Histogram: thermal scenes put long runs of pixels in the same bin, and
+ * one table would serialize every increment on the store of the one
+ * before. Four private u16 sub-histograms take consecutive pixels in
+ * turn so four increments are in flight, then get summed into the u32
+ * total with a loop the compiler vectorizes. A chunk is at most
+ * TCAM_AGC_SUB_CHUNK pixels, and its 1..3 leftover pixels go to
+ * different subs, so no sub sees more than 65535 pixels and a u16 bin
+ * cannot wrap.
+ *
+ * Curve and smoothing are done in Q16 fixed point over the 16K bins.
+ * The apply pass is a byte LUT lookup per pixel, AVX2 gathers on x86.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define		TCAM_AGC_X86
+#endif
+
+#include "tcam_agc.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_AGC_MASK			(TCAM_AGC_BINS - 1)
+#define		TCAM_AGC_SUBS			(4)
+#define		TCAM_AGC_SUB_CHUNK		((size_t)TCAM_AGC_SUBS * 65535)
+#define		TCAM_AGC_ONE			(65535)		//	Q16 1.0 of the curve
+
+struct __tcam_agc__ {
+	TCAM_AGC_CFG_T	cfg;
+	uint32_t		pixels;			//	of the last histogram
+	int				primed;			//	curve holds a previous frame
+
+	uint16_t		sub[TCAM_AGC_SUBS][TCAM_AGC_BINS] __attribute__((aligned(64)));
+	uint32_t		hist[TCAM_AGC_BINS] __attribute__((aligned(64)));
+	uint16_t		curve[TCAM_AGC_BINS] __attribute__((aligned(64)));
+	//	+4 : 32 bit gather of the last entry
+	uint8_t			lut[TCAM_AGC_BINS + 4] __attribute__((aligned(64)));
+};
+
+static void (*g_agc_apply)(const uint8_t* lut, const uint16_t* counts, uint8_t* out, size_t n);
+
+
+void tcam_agc_default_cfg(TCAM_AGC_CFG_T* cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+
+	cfg->plateau	= 0;
+	cfg->smooth		= 32;		//	1/8, 60 fps 에서 약 0.1 s 에 수렴
+	cfg->out_min	= 0;
+	cfg->out_max	= 255;
+}
+
+static int tcam_agc_check_cfg(const TCAM_AGC_CFG_T* cfg)
+{
+	if ( 0 == cfg->smooth || cfg->smooth > 256 || cfg->out_min > cfg->out_max )
+		return -EINVAL;
+
+	return 0;
+}
+
+static void tcam_agc_apply_scalar(const uint8_t* lut, const uint16_t* counts, uint8_t* out, size_t n)
+{
+	size_t	i;
+
+	for ( i = 0; i < n; i++ )
+		out[i] = lut[counts[i] & TCAM_AGC_MASK];
+}
+
+#ifdef TCAM_AGC_X86
+__attribute__((target("avx2")))
+static void tcam_agc_apply_avx2(const uint8_t* lut, const uint16_t* counts, uint8_t* out, size_t n)
+{
+	const __m256i	mask = _mm256_set1_epi32(TCAM_AGC_MASK);
+	const __m256i	low = _mm256_set1_epi32(0xff);
+	__m256i		i0, i1, i2, i3, w0, w1;
+	size_t		i = 0;
+
+	for ( ; i + 32 <= n; i += 32 ) {
+		i0 = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i))), mask);
+		i1 = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i + 8))), mask);
+		i2 = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i + 16))), mask);
+		i3 = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i + 24))), mask);
+
+		i0 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, i0, 1), low);
+		i1 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, i1, 1), low);
+		i2 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, i2, 1), low);
+		i3 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, i3, 1), low);
+
+		//	32 -> 16 -> 8 bit, lane 순서는 마지막에 한 번 맞춘다
+		w0 = _mm256_packus_epi32(i0, i1);
+		w1 = _mm256_packus_epi32(i2, i3);
+		w0 = _mm256_packus_epi16(w0, w1);
+		w0 = _mm256_permutevar8x32_epi32(w0, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+		_mm256_storeu_si256((__m256i*)(out + i), w0);
+	}
+
+	tcam_agc_apply_scalar(lut, counts + i, out + i, n - i);
+}
+#endif
+
+static void tcam_agc_select(void)
+{
+	void (*apply)(const uint8_t*, const uint16_t*, uint8_t*, size_t) = tcam_agc_apply_scalar;
+
+#ifdef TCAM_AGC_X86
+	if ( __builtin_cpu_supports("avx2") )
+		apply = tcam_agc_apply_avx2;
+#endif
+
+	__atomic_store_n(&g_agc_apply, apply, __ATOMIC_RELEASE);
+}
+
+int tcam_agc_create(TCAM_AGC_T** out, const TCAM_AGC_CFG_T* cfg)
+{
+	TCAM_AGC_T*	agc;
+	int		i;
+
+	*out = NULL;
+
+	if ( tcam_agc_check_cfg(cfg) )
+		return -EINVAL;
+
+	agc = aligned_alloc(64, (sizeof(*agc) + 63) & ~(size_t)63);
+	if ( NULL == agc )
+		return -ENOMEM;
+
+	memset(agc, 0, sizeof(*agc));
+	agc->cfg = *cfg;
+
+	//	첫 frame 전에는 linear
+	for ( i = 0; i < TCAM_AGC_BINS; i++ )
+		agc->lut[i] = cfg->out_min + (uint8_t)((uint32_t)i * (cfg->out_max - cfg->out_min) / TCAM_AGC_MASK);
+
+	if ( NULL == __atomic_load_n(&g_agc_apply, __ATOMIC_ACQUIRE) )
+		tcam_agc_select();
+
+	*out = agc;
+
+	return 0;
+}
+
+void tcam_agc_destroy(TCAM_AGC_T* agc)
+{
+	free(agc);
+}
+
+int tcam_agc_set_cfg(TCAM_AGC_T* agc, const TCAM_AGC_CFG_T* cfg)
+{
+	if ( tcam_agc_check_cfg(cfg) )
+		return -EINVAL;
+
+	agc->cfg = *cfg;
+
+	return 0;
+}
+
+void tcam_agc_reset(TCAM_AGC_T* agc)
+{
+	agc->primed = 0;
+}
+
+static void tcam_agc_merge(TCAM_AGC_T* agc)
+{
+	uint16_t*	s0 = agc->sub[0];
+	uint16_t*	s1 = agc->sub[1];
+	uint16_t*	s2 = agc->sub[2];
+	uint16_t*	s3 = agc->sub[3];
+	int		b;
+
+	for ( b = 0; b < TCAM_AGC_BINS; b++ )
+		agc->hist[b] += (uint32_t)s0[b] + s1[b] + s2[b] + s3[b];
+
+	memset(agc->sub, 0, sizeof(agc->sub));
+}
+
+void tcam_agc_histogram(TCAM_AGC_T* agc, const uint16_t* counts, size_t n)
+{
+	uint16_t*	s0 = agc->sub[0];
+	uint16_t*	s1 = agc->sub[1];
+	uint16_t*	s2 = agc->sub[2];
+	uint16_t*	s3 = agc->sub[3];
+	size_t		i, end, chunk;
+
+	memset(agc->hist, 0, sizeof(agc->hist));
+	agc->pixels = (uint32_t)n;
+
+	for ( i = 0; i < n; i = end ) {
+		chunk	= n - i < TCAM_AGC_SUB_CHUNK ? n - i : TCAM_AGC_SUB_CHUNK;
+		end		= i + chunk;
+
+		for ( ; i + 4 <= end; i += 4 ) {
+			s0[counts[i]     & TCAM_AGC_MASK]++;
+			s1[counts[i + 1] & TCAM_AGC_MASK]++;
+			s2[counts[i + 2] & TCAM_AGC_MASK]++;
+			s3[counts[i + 3] & TCAM_AGC_MASK]++;
+		}
+		//	1..3 left over, one per sub like the quads
+		switch ( end - i ) {
+		case 3:
+			s2[counts[i + 2] & TCAM_AGC_MASK]++;
+			/* fall through */
+		case 2:
+			s1[counts[i + 1] & TCAM_AGC_MASK]++;
+			/* fall through */
+		case 1:
+			s0[counts[i] & TCAM_AGC_MASK]++;
+		}
+		i = end;
+
+		tcam_agc_merge(agc);
+	}
+}
+
+void tcam_agc_update(TCAM_AGC_T* agc)
+{
+	const TCAM_AGC_CFG_T*	cfg = &agc->cfg;
+	uint32_t	plateau, cdf = 0, total = 0, range;
+	uint64_t	scale;
+	int32_t		cur, next;
+	int		b;
+
+	plateau = cfg->plateau ? cfg->plateau : agc->pixels / TCAM_AGC_AUTO_PLATEAU_DIV;
+	if ( 0 == plateau )
+		plateau = 1;
+
+	for ( b = 0; b < TCAM_AGC_BINS; b++ )
+		total += agc->hist[b] < plateau ? agc->hist[b] : plateau;
+
+	if ( 0 == total )
+		return;
+
+	scale = ((uint64_t)TCAM_AGC_ONE << 32) / total;
+	range = cfg->out_max - cfg->out_min;
+
+	for ( b = 0; b < TCAM_AGC_BINS; b++ ) {
+		cdf += agc->hist[b] < plateau ? agc->hist[b] : plateau;
+		next = (int32_t)(((uint64_t)cdf * scale) >> 32);
+
+		if ( agc->primed ) {
+			cur		= agc->curve[b];
+			next	= cur + (((next - cur) * (int32_t)cfg->smooth) >> 8);
+		}
+
+		agc->curve[b]	= (uint16_t)next;
+		agc->lut[b]		= cfg->out_min + (uint8_t)(((uint32_t)next * range + TCAM_AGC_ONE / 2) / TCAM_AGC_ONE);
+	}
+
+	agc->primed = 1;
+
+#ifdef TCAMLIB_DBG_MSG
+	fprintf(stderr, "tcam_agc: %u px, plateau %u, clipped %u\n", agc->pixels, plateau, total);
+#endif
+}
+
+void tcam_agc_apply(const TCAM_AGC_T* agc, const uint16_t* counts, uint8_t* out, size_t n)
+{
+	g_agc_apply(agc->lut, counts, out, n);
+}
+
+void tcam_agc_process(TCAM_AGC_T* agc, const uint16_t* counts, uint8_t* out, size_t n)
+{
+	tcam_agc_histogram(agc, counts, n);
+	tcam_agc_update(agc);
+	tcam_agc_apply(agc, counts, out, n);
+}
+
+const uint8_t* tcam_agc_lut(const TCAM_AGC_T* agc)
+{
+	return agc->lut;
+}
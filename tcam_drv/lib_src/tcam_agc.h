@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * AGC for the raw stream: 14 bit counts to an 8 bit display image by
+ * plateau histogram equalization, standing in for the FPGA AGC of
+ * tcam-vdo.
+ *
+ * Per frame: 16K bin histogram, every bin clipped at the plateau, the
+ * clipped CDF becomes the transfer curve, the curve is blended into the
+ * previous one (no pumping on scene changes) and written out as a 16K
+ * entry u8 LUT that is applied to the frame.
+ *
+ *   tcam_agc_process(agc, plane, out, TCAM_RAW_WIDTH * TCAM_RAW_HEIGHT);
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_AGC_H__
+#define __TCAM_AGC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_AGC_BINS			(16384)		//	14 bit counts
+
+typedef struct __tcam_agc_cfg__ {
+	uint32_t	plateau;		//	max pixels per bin, 0: n / TCAM_AGC_AUTO_PLATEAU_DIV
+	uint16_t	smooth;			//	weight of the new curve, 1..256 (256: none)
+	uint8_t		out_min;		//	output range
+	uint8_t		out_max;
+} TCAM_AGC_CFG_T;
+
+#define		TCAM_AGC_AUTO_PLATEAU_DIV	(512)
+
+typedef struct __tcam_agc__ TCAM_AGC_T;
+
+void tcam_agc_default_cfg(TCAM_AGC_CFG_T* cfg);
+
+int tcam_agc_create(TCAM_AGC_T** agc, const TCAM_AGC_CFG_T* cfg);
+void tcam_agc_destroy(TCAM_AGC_T* agc);
+
+/* takes effect on the next update, 0 or -EINVAL */
+int tcam_agc_set_cfg(TCAM_AGC_T* agc, const TCAM_AGC_CFG_T* cfg);
+
+/* restart the temporal smoothing from the next frame */
+void tcam_agc_reset(TCAM_AGC_T* agc);
+
+/* the three steps of tcam_agc_process(), for callers that split them */
+void tcam_agc_histogram(TCAM_AGC_T* agc, const uint16_t* counts, size_t n);
+void tcam_agc_update(TCAM_AGC_T* agc);
+void tcam_agc_apply(const TCAM_AGC_T* agc, const uint16_t* counts, uint8_t* out, size_t n);
+
+/* histogram, update and apply, n counts to n bytes */
+void tcam_agc_process(TCAM_AGC_T* agc, const uint16_t* counts, uint8_t* out, size_t n);
+
+/* current count to 8 bit LUT, TCAM_AGC_BINS entries */
+const uint8_t* tcam_agc_lut(const TCAM_AGC_T* agc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_AGC_H__ */
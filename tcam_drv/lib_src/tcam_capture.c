@@ -0,0 +1,475 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Zero-copy capture from the COX LWIR capture node.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/videodev2.h>
+
+#include "tcam_capture.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_WIDTH				(384)
+#define		TCAM_RAW_HEIGHT			(289)		//	288 + telemetry line
+#define		TCAM_VDO_HEIGHT			(288)
+
+typedef enum __tcam_buf_state__ {
+	TCAM_BUF_FREE = 0,		//	owned by the library
+	TCAM_BUF_QUEUED,		//	owned by the driver
+	TCAM_BUF_BORROWED,		//	owned by the consumer
+} eTCAM_BUF_STATE;
+
+typedef struct __tcam_capture_buf__ {
+	void*			addr;
+	size_t			length;
+	int				dmabuf_fd;
+	int				owned_fd;		//	close dmabuf_fd on teardown
+	eTCAM_BUF_STATE	state;
+} TCAM_CAPTURE_BUF_T;
+
+struct __tcam_capture__ {
+	int					fd;
+	eTCAM_MEM			memory;
+	int					streaming;
+	struct v4l2_pix_format	fmt;
+
+	uint32_t			buf_count;
+	TCAM_CAPTURE_BUF_T	bufs[TCAM_CAPTURE_MAX_BUFS];
+};
+
+
+static int tcam_ioctl(int fd, unsigned long req, void* arg)
+{
+	int		ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while ( ret < 0 && EINTR == errno );
+
+	return ret < 0 ? -errno : 0;
+}
+
+static uint32_t tcam_v4l2_memory(const TCAM_CAPTURE_T* cap)
+{
+	return TCAM_MEM_DMABUF == cap->memory ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP;
+}
+
+static int tcam_set_format(TCAM_CAPTURE_T* cap, int raw)
+{
+	struct v4l2_format	fmt;
+	int		ret;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type					= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width			= TCAM_WIDTH;
+	fmt.fmt.pix.height			= raw ? TCAM_RAW_HEIGHT : TCAM_VDO_HEIGHT;
+	fmt.fmt.pix.pixelformat		= raw ? V4L2_PIX_FMT_UYVY : V4L2_PIX_FMT_YUYV;
+	fmt.fmt.pix.field			= V4L2_FIELD_NONE;
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_S_FMT, &fmt);
+	if ( ret )
+		return ret;
+
+	//	드라이버가 다른 포맷으로 바꾸면 실패 처리
+	if ( fmt.fmt.pix.width != TCAM_WIDTH ||
+	     fmt.fmt.pix.height != (raw ? TCAM_RAW_HEIGHT : TCAM_VDO_HEIGHT) ||
+	     fmt.fmt.pix.pixelformat != (raw ? V4L2_PIX_FMT_UYVY : V4L2_PIX_FMT_YUYV) )
+		return -EINVAL;
+
+	cap->fmt = fmt.fmt.pix;
+
+	return 0;
+}
+
+static int tcam_heap_alloc(const char* heap, size_t len)
+{
+	struct dma_heap_allocation_data		alloc;
+	int		fd, ret;
+
+	fd = open(heap, O_RDWR | O_CLOEXEC);
+	if ( fd < 0 )
+		return -errno;
+
+	memset(&alloc, 0, sizeof(alloc));
+	alloc.len		= len;
+	alloc.fd_flags	= O_RDWR | O_CLOEXEC;
+
+	ret = tcam_ioctl(fd, DMA_HEAP_IOCTL_ALLOC, &alloc);
+	close(fd);
+
+	return ret ? ret : (int)alloc.fd;
+}
+
+static int tcam_dmabuf_sync(const TCAM_CAPTURE_BUF_T* buf, uint64_t flags)
+{
+	struct dma_buf_sync		sync = { .flags = flags | DMA_BUF_SYNC_READ };
+
+	if ( buf->dmabuf_fd < 0 )
+		return 0;
+
+	return tcam_ioctl(buf->dmabuf_fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+static int tcam_map_mmap(TCAM_CAPTURE_T* cap, uint32_t index, int export_dmabuf)
+{
+	TCAM_CAPTURE_BUF_T*		buf = &cap->bufs[index];
+	struct v4l2_buffer		vbuf;
+	struct v4l2_exportbuffer	expbuf;
+	int		ret;
+
+	memset(&vbuf, 0, sizeof(vbuf));
+	vbuf.type	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	vbuf.memory	= V4L2_MEMORY_MMAP;
+	vbuf.index	= index;
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_QUERYBUF, &vbuf);
+	if ( ret )
+		return ret;
+
+	buf->length	= vbuf.length;
+	buf->addr	= mmap(NULL, vbuf.length, PROT_READ, MAP_SHARED, cap->fd, vbuf.m.offset);
+	if ( MAP_FAILED == buf->addr ) {
+		buf->addr = NULL;
+		return -errno;
+	}
+
+	if ( !export_dmabuf )
+		return 0;
+
+	memset(&expbuf, 0, sizeof(expbuf));
+	expbuf.type		= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	expbuf.index	= index;
+	expbuf.flags	= O_RDONLY | O_CLOEXEC;
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_EXPBUF, &expbuf);
+	if ( ret )
+		return ret;
+
+	buf->dmabuf_fd	= expbuf.fd;
+	buf->owned_fd	= 1;
+
+	return 0;
+}
+
+static int tcam_map_dmabuf(TCAM_CAPTURE_T* cap, uint32_t index, const TCAM_CAPTURE_CFG_T* cfg)
+{
+	TCAM_CAPTURE_BUF_T*		buf = &cap->bufs[index];
+	size_t		len = cap->fmt.sizeimage;
+	long		page = sysconf(_SC_PAGESIZE);
+	int			fd;
+
+	if ( cfg->dmabuf_fds ) {
+		fd = cfg->dmabuf_fds[index];
+	}
+	else {
+		len = (len + page - 1) & ~(size_t)(page - 1);
+
+		if ( cfg->dma_heap ) {
+			fd = tcam_heap_alloc(cfg->dma_heap, len);
+		}
+		else {
+			//	RPi5 는 CMA heap, 없으면 system heap
+			fd = tcam_heap_alloc(TCAM_DMA_HEAP_CMA, len);
+			if ( fd < 0 )
+				fd = tcam_heap_alloc(TCAM_DMA_HEAP_SYSTEM, len);
+		}
+
+		if ( fd < 0 )
+			return fd;
+
+		buf->owned_fd = 1;
+	}
+
+	buf->dmabuf_fd	= fd;
+	buf->length		= len;
+	buf->addr		= mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if ( MAP_FAILED == buf->addr ) {
+		buf->addr = NULL;
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int tcam_queue(TCAM_CAPTURE_T* cap, uint32_t index)
+{
+	TCAM_CAPTURE_BUF_T*		buf = &cap->bufs[index];
+	struct v4l2_buffer		vbuf;
+	int		ret;
+
+	memset(&vbuf, 0, sizeof(vbuf));
+	vbuf.type	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	vbuf.memory	= tcam_v4l2_memory(cap);
+	vbuf.index	= index;
+
+	if ( TCAM_MEM_DMABUF == cap->memory ) {
+		vbuf.m.fd	= buf->dmabuf_fd;
+		vbuf.length	= buf->length;
+	}
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_QBUF, &vbuf);
+	if ( 0 == ret )
+		buf->state = TCAM_BUF_QUEUED;
+
+	return ret;
+}
+
+int tcam_capture_open(const TCAM_CAPTURE_CFG_T* cfg, TCAM_CAPTURE_T** out)
+{
+	TCAM_CAPTURE_T*				cap;
+	struct v4l2_capability		caps;
+	struct v4l2_requestbuffers	req;
+	uint32_t	dev_caps, i;
+	int			ret;
+
+	*out = NULL;
+
+	if ( cfg->buf_count > TCAM_CAPTURE_MAX_BUFS )
+		return -EINVAL;
+
+	cap = calloc(1, sizeof(*cap));
+	if ( NULL == cap )
+		return -ENOMEM;
+
+	cap->memory = cfg->memory;
+	for ( i = 0; i < TCAM_CAPTURE_MAX_BUFS; i++ )
+		cap->bufs[i].dmabuf_fd = -1;
+
+	//	O_NONBLOCK: acquire 는 poll 로 대기
+	cap->fd = open(cfg->device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if ( cap->fd < 0 ) {
+		ret = -errno;
+		free(cap);
+		return ret;
+	}
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_QUERYCAP, &caps);
+	if ( ret )
+		goto fail;
+
+	dev_caps = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps : caps.capabilities;
+	if ( !(dev_caps & V4L2_CAP_VIDEO_CAPTURE) || !(dev_caps & V4L2_CAP_STREAMING) ) {
+		ret = -ENODEV;
+		goto fail;
+	}
+
+	ret = tcam_set_format(cap, cfg->raw);
+	if ( ret )
+		goto fail;
+
+	memset(&req, 0, sizeof(req));
+	req.count	= cfg->buf_count ? cfg->buf_count : TCAM_CAPTURE_DEF_BUFS;
+	req.type	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory	= tcam_v4l2_memory(cap);
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_REQBUFS, &req);
+	if ( ret )
+		goto fail;
+
+	//	caller fds can not follow a driver adjusted count
+	if ( 0 == req.count || req.count > TCAM_CAPTURE_MAX_BUFS ||
+	     (cfg->dmabuf_fds && req.count != cfg->buf_count) ) {
+		cap->buf_count = req.count;
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	cap->buf_count = req.count;
+
+	for ( i = 0; i < cap->buf_count; i++ ) {
+		if ( TCAM_MEM_DMABUF == cap->memory )
+			ret = tcam_map_dmabuf(cap, i, cfg);
+		else
+			ret = tcam_map_mmap(cap, i, cfg->export_dmabuf);
+		if ( ret )
+			goto fail;
+	}
+
+	*out = cap;
+
+	return 0;
+
+fail:
+	tcam_capture_close(cap);
+
+	return ret;
+}
+
+void tcam_capture_close(TCAM_CAPTURE_T* cap)
+{
+	struct v4l2_requestbuffers	req;
+	uint32_t	i;
+
+	if ( NULL == cap )
+		return;
+
+	if ( cap->streaming )
+		tcam_capture_stop(cap);
+
+	for ( i = 0; i < TCAM_CAPTURE_MAX_BUFS; i++ ) {
+		if ( cap->bufs[i].addr )
+			munmap(cap->bufs[i].addr, cap->bufs[i].length);
+		if ( cap->bufs[i].owned_fd )
+			close(cap->bufs[i].dmabuf_fd);
+	}
+
+	if ( cap->buf_count ) {
+		memset(&req, 0, sizeof(req));
+		req.type	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		req.memory	= tcam_v4l2_memory(cap);
+		tcam_ioctl(cap->fd, VIDIOC_REQBUFS, &req);
+	}
+
+	close(cap->fd);
+	free(cap);
+}
+
+int tcam_capture_start(TCAM_CAPTURE_T* cap)
+{
+	int		type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	uint32_t	i;
+	int		ret;
+
+	if ( cap->streaming )
+		return 0;
+
+	//	consumer 가 가진 버퍼는 release 때 큐에 넣는다
+	for ( i = 0; i < cap->buf_count; i++ ) {
+		if ( TCAM_BUF_FREE != cap->bufs[i].state )
+			continue;
+
+		ret = tcam_queue(cap, i);
+		if ( ret )
+			return ret;
+	}
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_STREAMON, &type);
+	if ( 0 == ret )
+		cap->streaming = 1;
+
+	return ret;
+}
+
+int tcam_capture_stop(TCAM_CAPTURE_T* cap)
+{
+	int		type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	uint32_t	i;
+	int		ret;
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_STREAMOFF, &type);
+
+	//	STREAMOFF dequeues everything, borrowed views stay mapped
+	for ( i = 0; i < cap->buf_count; i++ ) {
+		if ( TCAM_BUF_QUEUED == cap->bufs[i].state )
+			cap->bufs[i].state = TCAM_BUF_FREE;
+	}
+
+	cap->streaming = 0;
+
+	return ret;
+}
+
+int tcam_capture_fd(const TCAM_CAPTURE_T* cap)
+{
+	return cap->fd;
+}
+
+void tcam_capture_format(const TCAM_CAPTURE_T* cap, TCAM_FRAME_T* fmt)
+{
+	memset(fmt, 0, sizeof(*fmt));
+	fmt->width			= cap->fmt.width;
+	fmt->height			= cap->fmt.height;
+	fmt->stride			= cap->fmt.bytesperline;
+	fmt->pixelformat	= cap->fmt.pixelformat;
+	fmt->bytesused		= cap->fmt.sizeimage;
+	fmt->dmabuf_fd		= -1;
+}
+
+int tcam_capture_acquire(TCAM_CAPTURE_T* cap, TCAM_FRAME_T* frame, int timeout_ms)
+{
+	TCAM_CAPTURE_BUF_T*		buf;
+	struct v4l2_buffer		vbuf;
+	struct pollfd			pfd = { .fd = cap->fd, .events = POLLIN };
+	int		ret;
+
+	if ( 0 != timeout_ms ) {
+		do {
+			ret = poll(&pfd, 1, timeout_ms);
+		} while ( ret < 0 && EINTR == errno );
+
+		if ( ret < 0 )
+			return -errno;
+		if ( 0 == ret )
+			return -ETIMEDOUT;
+	}
+
+	memset(&vbuf, 0, sizeof(vbuf));
+	vbuf.type	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	vbuf.memory	= tcam_v4l2_memory(cap);
+
+	ret = tcam_ioctl(cap->fd, VIDIOC_DQBUF, &vbuf);
+	if ( ret )
+		return ret;
+
+	buf = &cap->bufs[vbuf.index];
+	buf->state = TCAM_BUF_BORROWED;
+
+	if ( TCAM_MEM_DMABUF == cap->memory )
+		tcam_dmabuf_sync(buf, DMA_BUF_SYNC_START);
+
+	frame->data			= buf->addr;
+	frame->bytesused	= vbuf.bytesused;
+	frame->width		= cap->fmt.width;
+	frame->height		= cap->fmt.height;
+	frame->stride		= cap->fmt.bytesperline;
+	frame->pixelformat	= cap->fmt.pixelformat;
+	frame->sequence		= vbuf.sequence;
+	frame->flags		= vbuf.flags;
+	frame->timestamp_ns	= (uint64_t)vbuf.timestamp.tv_sec * 1000000000ULL +
+						  (uint64_t)vbuf.timestamp.tv_usec * 1000ULL;
+	frame->dmabuf_fd	= buf->dmabuf_fd;
+	frame->index		= vbuf.index;
+
+	#ifdef TCAMLIB_DBG_MSG
+	printf("acquire %u seq %u\n", frame->index, frame->sequence);
+	#endif
+
+	return 0;
+}
+
+int tcam_capture_release(TCAM_CAPTURE_T* cap, const TCAM_FRAME_T* frame)
+{
+	TCAM_CAPTURE_BUF_T*		buf;
+
+	if ( frame->index >= cap->buf_count )
+		return -EINVAL;
+
+	buf = &cap->bufs[frame->index];
+	if ( TCAM_BUF_BORROWED != buf->state )
+		return -EINVAL;
+
+	if ( TCAM_MEM_DMABUF == cap->memory )
+		tcam_dmabuf_sync(buf, DMA_BUF_SYNC_END);
+
+	if ( !cap->streaming ) {
+		buf->state = TCAM_BUF_FREE;
+		return 0;
+	}
+
+	return tcam_queue(cap, frame->index);
+}
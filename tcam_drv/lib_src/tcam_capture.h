@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Zero-copy capture from the COX LWIR capture node.
+ *
+ * The library owns a ring of MMAP or DMABUF buffers. A dequeued buffer is
+ * handed out as a TCAM_FRAME_T view of the ring memory and goes back to
+ * the driver on tcam_capture_release(); nothing is copied in between.
+ * While the consumer holds views the driver has fewer buffers to fill,
+ * frames are dropped (sequence gaps) once it holds all of them.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_CAPTURE_H__
+#define __TCAM_CAPTURE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_CAPTURE_DEF_BUFS	(4)
+#define		TCAM_CAPTURE_MAX_BUFS	(32)
+
+#define		TCAM_DMA_HEAP_CMA		"/dev/dma_heap/linux,cma"
+#define		TCAM_DMA_HEAP_SYSTEM	"/dev/dma_heap/system"
+
+typedef enum __tcam_capture_memory__ {
+	TCAM_MEM_MMAP = 0,		//	driver allocated, mmap()ed
+	TCAM_MEM_DMABUF,		//	imported dma-buf, from dmabuf_fds or a dma heap
+} eTCAM_MEM;
+
+typedef struct __tcam_capture_cfg__ {
+	const char*		device;			//	capture node, e.g. $TCAMRAW_DEVICE
+	int				raw;			//	1: 384x289 UYVY, 0: 384x288 YUYV
+	uint32_t		buf_count;		//	ring size, 0 for TCAM_CAPTURE_DEF_BUFS
+	eTCAM_MEM		memory;
+
+	int				export_dmabuf;	//	MMAP: VIDIOC_EXPBUF every buffer
+
+	const int*		dmabuf_fds;		//	DMABUF: buf_count caller owned fds, or NULL
+	const char*		dma_heap;		//	DMABUF without fds, NULL tries cma then system
+} TCAM_CAPTURE_CFG_T;
+
+typedef struct __tcam_frame__ {
+	const uint8_t*	data;			//	valid until tcam_capture_release()
+	uint32_t		bytesused;
+	uint32_t		width;
+	uint32_t		height;			//	including telemetry lines
+	uint32_t		stride;			//	bytes per line
+	uint32_t		pixelformat;
+	uint32_t		sequence;
+	uint32_t		flags;			//	V4L2_BUF_FLAG_*
+	uint64_t		timestamp_ns;	//	CLOCK_MONOTONIC
+	int				dmabuf_fd;		//	buffer as dma-buf, -1 when not available
+	uint32_t		index;			//	ring slot
+} TCAM_FRAME_T;
+
+typedef struct __tcam_capture__ TCAM_CAPTURE_T;
+
+/* open, negotiate the format and set up the ring, 0 or -errno */
+int tcam_capture_open(const TCAM_CAPTURE_CFG_T* cfg, TCAM_CAPTURE_T** cap);
+void tcam_capture_close(TCAM_CAPTURE_T* cap);
+
+int tcam_capture_start(TCAM_CAPTURE_T* cap);
+int tcam_capture_stop(TCAM_CAPTURE_T* cap);
+
+/* capture node fd, readable (POLLIN) when a frame can be acquired */
+int tcam_capture_fd(const TCAM_CAPTURE_T* cap);
+
+/* negotiated format, frame fields other than the format ones are zero */
+void tcam_capture_format(const TCAM_CAPTURE_T* cap, TCAM_FRAME_T* fmt);
+
+/*
+ * Borrow the next frame. timeout_ms < 0 waits forever, 0 does not wait.
+ * 0 on success, -EAGAIN / -ETIMEDOUT when no frame, -errno on error.
+ */
+int tcam_capture_acquire(TCAM_CAPTURE_T* cap, TCAM_FRAME_T* frame, int timeout_ms);
+
+/* hand a borrowed frame back to the driver */
+int tcam_capture_release(TCAM_CAPTURE_T* cap, const TCAM_FRAME_T* frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_CAPTURE_H__ */
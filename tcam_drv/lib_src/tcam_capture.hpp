@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * C++ wrapper for tcam_capture.h.
+ *
+ *   tcam::Capture cap({ .device = dev, .raw = 1 });
+ *   cap.start();
+ *   if ( auto frame = cap.acquire(100) )
+ *       use(frame.data(), frame.stride());		//	released at scope exit
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_CAPTURE_HPP__
+#define __TCAM_CAPTURE_HPP__
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+#include "tcam_capture.h"
+
+namespace tcam {
+
+/*
+ * Borrowed view of a ring buffer, move only, hands the buffer back on
+ * destruction. Must not outlive the Capture it came from.
+ */
+class Frame {
+public:
+	Frame() = default;
+	Frame(TCAM_CAPTURE_T* cap, const TCAM_FRAME_T& frame) : cap_(cap), frame_(frame) {}
+	~Frame() { release(); }
+
+	Frame(const Frame&) = delete;
+	Frame& operator=(const Frame&) = delete;
+
+	Frame(Frame&& other) noexcept : cap_(std::exchange(other.cap_, nullptr)), frame_(other.frame_) {}
+	Frame& operator=(Frame&& other) noexcept
+	{
+		if ( this != &other ) {
+			release();
+			cap_	= std::exchange(other.cap_, nullptr);
+			frame_	= other.frame_;
+		}
+		return *this;
+	}
+
+	explicit operator bool() const { return nullptr != cap_; }
+
+	const uint8_t*	data() const { return frame_.data; }
+	uint32_t		size() const { return frame_.bytesused; }
+	uint32_t		width() const { return frame_.width; }
+	uint32_t		height() const { return frame_.height; }
+	uint32_t		stride() const { return frame_.stride; }
+	uint32_t		pixelformat() const { return frame_.pixelformat; }
+	uint32_t		sequence() const { return frame_.sequence; }
+	uint64_t		timestamp_ns() const { return frame_.timestamp_ns; }
+	int				dmabuf_fd() const { return frame_.dmabuf_fd; }
+	const TCAM_FRAME_T&	raw() const { return frame_; }
+
+	void release()
+	{
+		if ( cap_ )
+			tcam_capture_release(std::exchange(cap_, nullptr), &frame_);
+	}
+
+private:
+	TCAM_CAPTURE_T*	cap_ = nullptr;
+	TCAM_FRAME_T	frame_ = {};
+};
+
+/* owns the capture node and its buffer ring, throws std::system_error on setup failure */
+class Capture {
+public:
+	explicit Capture(const TCAM_CAPTURE_CFG_T& cfg)
+	{
+		check(tcam_capture_open(&cfg, &cap_), "tcam_capture_open");
+	}
+	~Capture() { tcam_capture_close(cap_); }
+
+	Capture(const Capture&) = delete;
+	Capture& operator=(const Capture&) = delete;
+
+	Capture(Capture&& other) noexcept : cap_(std::exchange(other.cap_, nullptr)) {}
+	Capture& operator=(Capture&& other) noexcept
+	{
+		if ( this != &other ) {
+			tcam_capture_close(cap_);
+			cap_ = std::exchange(other.cap_, nullptr);
+		}
+		return *this;
+	}
+
+	void start() { check(tcam_capture_start(cap_), "tcam_capture_start"); }
+	void stop() { tcam_capture_stop(cap_); }
+	int fd() const { return tcam_capture_fd(cap_); }
+
+	/* empty Frame on timeout / no frame, throws on device errors */
+	Frame acquire(int timeout_ms = -1)
+	{
+		TCAM_FRAME_T	frame;
+		int				ret = tcam_capture_acquire(cap_, &frame, timeout_ms);
+
+		if ( -EAGAIN == ret || -ETIMEDOUT == ret )
+			return Frame();
+		check(ret, "tcam_capture_acquire");
+
+		return Frame(cap_, frame);
+	}
+
+	TCAM_CAPTURE_T* handle() const { return cap_; }
+
+private:
+	static void check(int ret, const char* what)
+	{
+		if ( ret < 0 )
+			throw std::system_error(-ret, std::generic_category(), what);
+	}
+
+	TCAM_CAPTURE_T*	cap_ = nullptr;
+};
+
+}	// namespace tcam
+
+#endif	/* __TCAM_CAPTURE_HPP__ */
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * COX private V4L2 controls and events, shared by tcam-raw / tcam-vdo and
+ * the userspace library. Kernel and userspace both take it as is.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_CTRLS_H__
+#define __TCAM_CTRLS_H__
+
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+//	COX private controls
+#define		V4L2_CID_THERMAL_BASE				(V4L2_CID_USER_BASE | 0x1f00)
+#define		V4L2_CID_THERMAL_SNAPSHOT_MODE		(V4L2_CID_THERMAL_BASE + 0)		//	tcam-raw
+#define		V4L2_CID_THERMAL_SNAPSHOT_COUNT		(V4L2_CID_THERMAL_BASE + 1)		//	tcam-raw
+#define		V4L2_CID_THERMAL_SNAPSHOT_TRIGGER	(V4L2_CID_THERMAL_BASE + 2)		//	tcam-raw
+#define		V4L2_CID_THERMAL_FRAME_DECIMATION	(V4L2_CID_THERMAL_BASE + 3)
+#define		V4L2_CID_THERMAL_AGC_ROI_LEFT		(V4L2_CID_THERMAL_BASE + 4)		//	tcam-vdo
+#define		V4L2_CID_THERMAL_AGC_ROI_TOP		(V4L2_CID_THERMAL_BASE + 5)		//	tcam-vdo
+#define		V4L2_CID_THERMAL_AGC_ROI_WIDTH		(V4L2_CID_THERMAL_BASE + 6)		//	tcam-vdo
+#define		V4L2_CID_THERMAL_AGC_ROI_HEIGHT		(V4L2_CID_THERMAL_BASE + 7)		//	tcam-vdo
+#define		V4L2_CID_THERMAL_ALARM_ENABLE		(V4L2_CID_THERMAL_BASE + 8)		//	tcam-raw
+#define		V4L2_CID_THERMAL_ALARM_THRESHOLD	(V4L2_CID_THERMAL_BASE + 9)		//	tcam-raw
+#define		V4L2_CID_THERMAL_ALARM_HYSTERESIS	(V4L2_CID_THERMAL_BASE + 10)	//	tcam-raw
+
+//	COX private events
+#define		V4L2_EVENT_THERMAL_ALARM			(V4L2_EVENT_PRIVATE_START + 1)
+
+/* payload of V4L2_EVENT_THERMAL_ALARM, in v4l2_event.u.data */
+typedef struct __thermal_raw_alarm_event__ {
+	__u16		active;		//	1: raised, 0: cleared
+	__u16		peak;		//	hottest pixel (counts)
+	__u16		frame_cnt;	//	FPGA frame counter
+} TRAW_ALARM_EVT_T;
+
+#endif	/* __TCAM_CTRLS_H__ */
@@ -0,0 +1,516 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Single threaded event loop for several COX LWIR cameras.
+ *
+ * A capture source must be streaming while it is in the loop, vb2
+ * reports POLLERR on a stopped queue and the source is then dropped.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+
+#ifdef TCAM_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "tcam_loop.h"
+#include "tcam_rt.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_LOOP_EVENTS		(16)		//	epoll_wait batch
+#define		TCAM_LOOP_URING_DEPTH	(TCAM_LOOP_MAX_SRCS * 2)
+#define		TCAM_LOOP_WAKE_TAG		(0)			//	user data of the stop eventfd
+
+typedef enum __tcam_loop_src_type__ {
+	TCAM_SRC_NONE = 0,
+	TCAM_SRC_CAPTURE,
+	TCAM_SRC_SUBDEV,
+} eTCAM_SRC_TYPE;
+
+typedef struct __tcam_loop_src__ {
+	eTCAM_SRC_TYPE		type;
+	int					fd;
+	uint32_t			gen;			//	stale completions after remove
+	TCAM_CAPTURE_T*		cap;
+	TCAM_FRAME_CB		frame_cb;
+	TCAM_EVENT_CB		event_cb;
+	void*				priv;
+} TCAM_LOOP_SRC_T;
+
+struct __tcam_loop__ {
+	int					epfd;
+	int					wake_fd;
+	volatile int		stop;
+	TCAM_HIST_T*		lat_hist;
+
+	int					use_uring;
+#ifdef TCAM_HAVE_LIBURING
+	struct io_uring		ring;
+#endif
+
+	TCAM_LOOP_SRC_T		srcs[TCAM_LOOP_MAX_SRCS];
+};
+
+
+static int tcam_ioctl(int fd, unsigned long req, void* arg)
+{
+	int		ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while ( ret < 0 && EINTR == errno );
+
+	return ret < 0 ? -errno : 0;
+}
+
+/*
+ * Sources are identified by slot and generation, a completion queued
+ * before a remove never reaches a new source in the same slot.
+ */
+static uint64_t tcam_src_tag(const TCAM_LOOP_T* loop, const TCAM_LOOP_SRC_T* src)
+{
+	return ((uint64_t)src->gen << 32) | (uint64_t)(src - loop->srcs + 1);
+}
+
+static TCAM_LOOP_SRC_T* tcam_src_from_tag(TCAM_LOOP_T* loop, uint64_t tag)
+{
+	uint32_t			slot = (uint32_t)tag;
+	TCAM_LOOP_SRC_T*	src;
+
+	if ( TCAM_LOOP_WAKE_TAG == slot || slot > TCAM_LOOP_MAX_SRCS )
+		return NULL;
+
+	src = &loop->srcs[slot - 1];
+	if ( TCAM_SRC_NONE == src->type || src->gen != (uint32_t)(tag >> 32) )
+		return NULL;
+
+	return src;
+}
+
+static TCAM_LOOP_SRC_T* tcam_src_by_fd(TCAM_LOOP_T* loop, int fd)
+{
+	int		i;
+
+	for ( i = 0; i < TCAM_LOOP_MAX_SRCS; i++ ) {
+		if ( TCAM_SRC_NONE != loop->srcs[i].type && fd == loop->srcs[i].fd )
+			return &loop->srcs[i];
+	}
+
+	return NULL;
+}
+
+#ifdef TCAM_HAVE_LIBURING
+static int tcam_uring_arm(TCAM_LOOP_T* loop, int fd, uint64_t tag)
+{
+	struct io_uring_sqe*	sqe = io_uring_get_sqe(&loop->ring);
+
+	if ( NULL == sqe )
+		return -EBUSY;
+
+	io_uring_prep_poll_multishot(sqe, fd, POLLIN | POLLPRI);
+	io_uring_sqe_set_data64(sqe, tag);
+
+	return io_uring_submit(&loop->ring) < 0 ? -EIO : 0;
+}
+
+static void tcam_uring_disarm(TCAM_LOOP_T* loop, uint64_t tag)
+{
+	struct io_uring_sqe*	sqe = io_uring_get_sqe(&loop->ring);
+
+	if ( NULL == sqe )
+		return;
+
+	io_uring_prep_poll_remove(sqe, tag);
+	io_uring_sqe_set_data64(sqe, TCAM_LOOP_WAKE_TAG);
+	io_uring_submit(&loop->ring);
+}
+#endif
+
+static int tcam_loop_watch(TCAM_LOOP_T* loop, int fd, uint64_t tag)
+{
+	struct epoll_event	ev = { .events = EPOLLIN | EPOLLPRI, .data.u64 = tag };
+
+#ifdef TCAM_HAVE_LIBURING
+	if ( loop->use_uring )
+		return tcam_uring_arm(loop, fd, tag);
+#endif
+
+	return epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0 ? -errno : 0;
+}
+
+static void tcam_loop_unwatch(TCAM_LOOP_T* loop, TCAM_LOOP_SRC_T* src)
+{
+#ifdef TCAM_HAVE_LIBURING
+	if ( loop->use_uring ) {
+		tcam_uring_disarm(loop, tcam_src_tag(loop, src));
+		return;
+	}
+#endif
+
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+}
+
+static TCAM_LOOP_SRC_T* tcam_loop_add(TCAM_LOOP_T* loop, eTCAM_SRC_TYPE type, int fd)
+{
+	TCAM_LOOP_SRC_T*	src = NULL;
+	uint32_t			gen;
+	int		i, ret;
+
+	if ( tcam_src_by_fd(loop, fd) ) {
+		errno = EEXIST;
+		return NULL;
+	}
+
+	for ( i = 0; i < TCAM_LOOP_MAX_SRCS && NULL == src; i++ ) {
+		if ( TCAM_SRC_NONE == loop->srcs[i].type )
+			src = &loop->srcs[i];
+	}
+
+	if ( NULL == src ) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	gen = src->gen + 1;
+	memset(src, 0, sizeof(*src));
+	src->type	= type;
+	src->fd		= fd;
+	src->gen	= gen;
+
+	ret = tcam_loop_watch(loop, fd, tcam_src_tag(loop, src));
+	if ( ret ) {
+		src->type = TCAM_SRC_NONE;
+		errno = -ret;
+		return NULL;
+	}
+
+	return src;
+}
+
+static void tcam_loop_drop(TCAM_LOOP_T* loop, TCAM_LOOP_SRC_T* src)
+{
+	tcam_loop_unwatch(loop, src);
+	src->type = TCAM_SRC_NONE;
+}
+
+static int tcam_dispatch_events(TCAM_LOOP_SRC_T* src)
+{
+	struct v4l2_event	ev;
+	int		cnt = 0;
+
+	//	POLLPRI 는 이벤트가 모두 빠질 때까지 유지된다
+	while ( 0 == tcam_ioctl(src->fd, VIDIOC_DQEVENT, &ev) ) {
+		if ( src->event_cb )
+			src->event_cb(src->fd, &ev, src->priv);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+static int tcam_dispatch_frames(TCAM_LOOP_T* loop, TCAM_LOOP_SRC_T* src)
+{
+	TCAM_FRAME_T	frame;
+	int		cnt = 0;
+
+	while ( 0 == tcam_capture_acquire(src->cap, &frame, 0) ) {
+		if ( loop->lat_hist )
+			tcam_hist_record(loop->lat_hist, tcam_rt_latency_ns(&frame));
+
+		if ( TCAM_LOOP_KEEP != src->frame_cb(src->cap, &frame, src->priv) )
+			tcam_capture_release(src->cap, &frame);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+static int tcam_dispatch(TCAM_LOOP_T* loop, TCAM_LOOP_SRC_T* src, uint32_t revents)
+{
+	int		cnt = 0;
+
+	if ( revents & EPOLLPRI )
+		cnt += tcam_dispatch_events(src);
+
+	if ( TCAM_SRC_CAPTURE != src->type )
+		return cnt;
+
+	if ( revents & EPOLLIN )
+		cnt += tcam_dispatch_frames(loop, src);
+
+	if ( (revents & (EPOLLERR | EPOLLHUP)) && !(revents & EPOLLIN) ) {
+		src->frame_cb(src->cap, NULL, src->priv);
+		tcam_loop_drop(loop, src);
+	}
+
+	return cnt;
+}
+
+static void tcam_loop_wake_drain(TCAM_LOOP_T* loop)
+{
+	uint64_t	val;
+
+	if ( read(loop->wake_fd, &val, sizeof(val)) == sizeof(val) )
+		loop->stop = 1;
+}
+
+static int tcam_loop_wait_epoll(TCAM_LOOP_T* loop, int timeout_ms)
+{
+	struct epoll_event	evs[TCAM_LOOP_EVENTS];
+	TCAM_LOOP_SRC_T*	src;
+	int		n, i, cnt = 0;
+
+	n = epoll_wait(loop->epfd, evs, TCAM_LOOP_EVENTS, timeout_ms);
+	if ( n < 0 )
+		return EINTR == errno ? 0 : -errno;
+
+	for ( i = 0; i < n; i++ ) {
+		if ( TCAM_LOOP_WAKE_TAG == evs[i].data.u64 ) {
+			tcam_loop_wake_drain(loop);
+			continue;
+		}
+
+		src = tcam_src_from_tag(loop, evs[i].data.u64);
+		if ( src )
+			cnt += tcam_dispatch(loop, src, evs[i].events);
+	}
+
+	return cnt;
+}
+
+#ifdef TCAM_HAVE_LIBURING
+static int tcam_loop_wait_uring(TCAM_LOOP_T* loop, int timeout_ms)
+{
+	struct io_uring_cqe*		cqe;
+	struct __kernel_timespec	ts;
+	TCAM_LOOP_SRC_T*	src;
+	unsigned	head, seen = 0;
+	uint64_t	tag;
+	int		ret, cnt = 0;
+
+	ts.tv_sec	= timeout_ms / 1000;
+	ts.tv_nsec	= (long long)(timeout_ms % 1000) * 1000000;
+
+	//	busy-poll 은 timeout sqe 없이 CQ 만 확인한다
+	if ( 0 == timeout_ms )
+		ret = io_uring_peek_cqe(&loop->ring, &cqe);
+	else
+		ret = io_uring_wait_cqe_timeout(&loop->ring, &cqe, timeout_ms < 0 ? NULL : &ts);
+	if ( -ETIME == ret || -EINTR == ret || -EAGAIN == ret )
+		return 0;
+	if ( ret )
+		return ret;
+
+	io_uring_for_each_cqe(&loop->ring, head, cqe) {
+		seen++;
+		tag = io_uring_cqe_get_data64(cqe);
+
+		if ( TCAM_LOOP_WAKE_TAG == tag ) {
+			//	poll remove completions carry the wake tag too
+			if ( cqe->res > 0 )
+				tcam_loop_wake_drain(loop);
+			if ( cqe->res > 0 && !(cqe->flags & IORING_CQE_F_MORE) )
+				tcam_uring_arm(loop, loop->wake_fd, TCAM_LOOP_WAKE_TAG);
+			continue;
+		}
+
+		src = tcam_src_from_tag(loop, tag);
+		if ( NULL == src || cqe->res < 0 )
+			continue;
+
+		cnt += tcam_dispatch(loop, src, (uint32_t)cqe->res);
+
+		//	multishot ended (overflow), arm again
+		if ( TCAM_SRC_NONE != src->type && !(cqe->flags & IORING_CQE_F_MORE) )
+			tcam_uring_arm(loop, src->fd, tag);
+	}
+	io_uring_cq_advance(&loop->ring, seen);
+
+	return cnt;
+}
+#endif
+
+int tcam_loop_create(TCAM_LOOP_T** out, int flags)
+{
+	TCAM_LOOP_T*	loop;
+	int		ret;
+
+	*out = NULL;
+
+#ifndef TCAM_HAVE_LIBURING
+	if ( flags & TCAM_LOOP_IO_URING )
+		return -ENOTSUP;
+#endif
+
+	loop = calloc(1, sizeof(*loop));
+	if ( NULL == loop )
+		return -ENOMEM;
+
+	loop->epfd = -1;
+
+	loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if ( loop->wake_fd < 0 ) {
+		ret = -errno;
+		free(loop);
+		return ret;
+	}
+
+#ifdef TCAM_HAVE_LIBURING
+	if ( flags & TCAM_LOOP_IO_URING ) {
+		ret = io_uring_queue_init(TCAM_LOOP_URING_DEPTH, &loop->ring, 0);
+		if ( ret )
+			goto fail;
+
+		loop->use_uring = 1;
+	}
+#endif
+
+	if ( !loop->use_uring ) {
+		loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+		if ( loop->epfd < 0 ) {
+			ret = -errno;
+			goto fail;
+		}
+	}
+
+	ret = tcam_loop_watch(loop, loop->wake_fd, TCAM_LOOP_WAKE_TAG);
+	if ( ret )
+		goto fail;
+
+	*out = loop;
+
+	return 0;
+
+fail:
+	tcam_loop_destroy(loop);
+
+	return ret;
+}
+
+void tcam_loop_destroy(TCAM_LOOP_T* loop)
+{
+	if ( NULL == loop )
+		return;
+
+#ifdef TCAM_HAVE_LIBURING
+	if ( loop->use_uring )
+		io_uring_queue_exit(&loop->ring);
+#endif
+
+	if ( loop->epfd >= 0 )
+		close(loop->epfd);
+
+	close(loop->wake_fd);
+	free(loop);
+}
+
+int tcam_loop_add_capture(TCAM_LOOP_T* loop, TCAM_CAPTURE_T* cap,
+			  TCAM_FRAME_CB frame_cb, TCAM_EVENT_CB event_cb, void* priv)
+{
+	TCAM_LOOP_SRC_T*	src;
+
+	if ( NULL == frame_cb )
+		return -EINVAL;
+
+	src = tcam_loop_add(loop, TCAM_SRC_CAPTURE, tcam_capture_fd(cap));
+	if ( NULL == src )
+		return -errno;
+
+	src->cap		= cap;
+	src->frame_cb	= frame_cb;
+	src->event_cb	= event_cb;
+	src->priv		= priv;
+
+	return 0;
+}
+
+int tcam_loop_add_subdev(TCAM_LOOP_T* loop, int fd, TCAM_EVENT_CB event_cb, void* priv)
+{
+	TCAM_LOOP_SRC_T*	src;
+
+	if ( NULL == event_cb )
+		return -EINVAL;
+
+	src = tcam_loop_add(loop, TCAM_SRC_SUBDEV, fd);
+	if ( NULL == src )
+		return -errno;
+
+	src->event_cb	= event_cb;
+	src->priv		= priv;
+
+	return 0;
+}
+
+int tcam_loop_remove(TCAM_LOOP_T* loop, int fd)
+{
+	TCAM_LOOP_SRC_T*	src = tcam_src_by_fd(loop, fd);
+
+	if ( NULL == src )
+		return -ENOENT;
+
+	tcam_loop_drop(loop, src);
+
+	return 0;
+}
+
+int tcam_loop_run_once(TCAM_LOOP_T* loop, int timeout_ms)
+{
+#ifdef TCAM_HAVE_LIBURING
+	if ( loop->use_uring )
+		return tcam_loop_wait_uring(loop, timeout_ms);
+#endif
+
+	return tcam_loop_wait_epoll(loop, timeout_ms);
+}
+
+int tcam_loop_run(TCAM_LOOP_T* loop)
+{
+	return tcam_loop_run_poll(loop, -1);
+}
+
+int tcam_loop_run_poll(TCAM_LOOP_T* loop, int timeout_ms)
+{
+	int		ret = 0;
+
+	loop->stop = 0;
+
+	while ( !loop->stop && ret >= 0 )
+		ret = tcam_loop_run_once(loop, timeout_ms);
+
+	return ret < 0 ? ret : 0;
+}
+
+void tcam_loop_set_latency_hist(TCAM_LOOP_T* loop, struct __tcam_hist__* hist)
+{
+	loop->lat_hist = hist;
+}
+
+void tcam_loop_stop(TCAM_LOOP_T* loop)
+{
+	uint64_t	val = 1;
+
+	if ( write(loop->wake_fd, &val, sizeof(val)) < 0 )
+		loop->stop = 1;
+}
+
+int tcam_loop_subscribe(int fd, uint32_t type, uint32_t id, uint32_t flags)
+{
+	struct v4l2_event_subscription	sub;
+
+	memset(&sub, 0, sizeof(sub));
+	sub.type	= type;
+	sub.id		= id;
+	sub.flags	= flags;
+
+	return tcam_ioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub);
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Single threaded event loop for several COX LWIR cameras.
+ *
+ * One epoll set (or io_uring multishot polls when built with
+ * TCAM_HAVE_LIBURING) holds every capture node and subdev. A wakeup
+ * drains all frames and events that are ready on all of them, so N
+ * cameras cost one thread and roughly one wakeup per frame period.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_LOOP_H__
+#define __TCAM_LOOP_H__
+
+#include <stdint.h>
+
+#include <linux/videodev2.h>
+
+#include "tcam_capture.h"
+#include "tcam_ctrls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_LOOP_MAX_SRCS		(64)
+
+//	tcam_loop_create() flags
+#define		TCAM_LOOP_IO_URING		(1 << 0)	//	-ENOTSUP without liburing
+
+//	frame callback return value
+#define		TCAM_LOOP_RELEASE		(0)			//	loop releases the frame
+#define		TCAM_LOOP_KEEP			(1)			//	callback calls tcam_capture_release()
+
+/*
+ * frame is a borrowed view, see tcam_capture.h. NULL frame reports an
+ * error on the capture node (device gone), the source is removed.
+ */
+typedef int (*TCAM_FRAME_CB)(TCAM_CAPTURE_T* cap, const TCAM_FRAME_T* frame, void* priv);
+
+/* one call per dequeued V4L2 event (control change, alarm, source change) */
+typedef void (*TCAM_EVENT_CB)(int fd, const struct v4l2_event* ev, void* priv);
+
+typedef struct __tcam_loop__ TCAM_LOOP_T;
+
+struct __tcam_hist__;
+
+int tcam_loop_create(TCAM_LOOP_T** loop, int flags);
+void tcam_loop_destroy(TCAM_LOOP_T* loop);
+
+/* event_cb may be NULL; events must be subscribed on the fd beforehand */
+int tcam_loop_add_capture(TCAM_LOOP_T* loop, TCAM_CAPTURE_T* cap,
+			  TCAM_FRAME_CB frame_cb, TCAM_EVENT_CB event_cb, void* priv);
+int tcam_loop_add_subdev(TCAM_LOOP_T* loop, int fd, TCAM_EVENT_CB event_cb, void* priv);
+int tcam_loop_remove(TCAM_LOOP_T* loop, int fd);
+
+/* wait up to timeout_ms (-1 forever), dispatch, return frames + events handled */
+int tcam_loop_run_once(TCAM_LOOP_T* loop, int timeout_ms);
+
+/* dispatch until tcam_loop_stop(), 0 or -errno */
+int tcam_loop_run(TCAM_LOOP_T* loop);
+
+/* same, each wait limited to timeout_ms, 0 busy-polls */
+int tcam_loop_run_poll(TCAM_LOOP_T* loop, int timeout_ms);
+
+/*
+ * record buffer timestamp to frame callback entry of every frame in hist
+ * (tcam_rt.h), NULL turns it off
+ */
+void tcam_loop_set_latency_hist(TCAM_LOOP_T* loop, struct __tcam_hist__* hist);
+
+/* async-signal and thread safe */
+void tcam_loop_stop(TCAM_LOOP_T* loop);
+
+/* VIDIOC_SUBSCRIBE_EVENT helper, 0 or -errno */
+int tcam_loop_subscribe(int fd, uint32_t type, uint32_t id, uint32_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_LOOP_H__ */
@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Media pipeline setup for COX LWIR cameras on the RP1 CFE.
+ *
+ * Replaces the media-ctl / v4l2-ctl sequence of media_setting_rpi5.sh:
+ * one open of the media device, entity lookup by name, link setup on the
+ * csi2 source pads and the format on every pad of the path.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include <linux/media.h>
+#include <linux/media-bus-format.h>
+#include <linux/v4l2-subdev.h>
+#include <linux/videodev2.h>
+
+#include "tcam_media.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_MEDIA_MAX_DEV		(64)
+
+
+static int tcam_ioctl(int fd, unsigned long req, void* arg)
+{
+	int		ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while ( ret < 0 && EINTR == errno );
+
+	return ret < 0 ? -errno : 0;
+}
+
+/*
+ * /dev/videoN numbering depends on probe order, the char device number
+ * reported by the media controller does not. Resolve it through sysfs.
+ */
+static int tcam_devnode_path(const struct media_entity_desc* ent, char* path, size_t len)
+{
+	char		sys[64];
+	char		line[128];
+	FILE*		fp;
+
+	snprintf(sys, sizeof(sys), "/sys/dev/char/%u:%u/uevent", ent->dev.major, ent->dev.minor);
+
+	fp = fopen(sys, "r");
+	if ( NULL == fp )
+		return -errno;
+
+	while ( fgets(line, sizeof(line), fp) ) {
+		if ( 0 == strncmp(line, "DEVNAME=", 8) ) {
+			line[strcspn(line, "\n")] = '\0';
+			fclose(fp);
+			if ( snprintf(path, len, "/dev/%s", line + 8) >= (int)len )
+				return -ENAMETOOLONG;
+			return 0;
+		}
+	}
+
+	fclose(fp);
+
+	return -ENOENT;
+}
+
+static int tcam_find_entity(int fd, const char* name, struct media_entity_desc* ent)
+{
+	uint32_t	id = 0;
+
+	for ( ;; ) {
+		memset(ent, 0, sizeof(*ent));
+		ent->id = id | MEDIA_ENT_ID_FLAG_NEXT;
+
+		if ( tcam_ioctl(fd, MEDIA_IOC_ENUM_ENTITIES, ent) )
+			return -ENOENT;
+
+		if ( 0 == strcmp(ent->name, name) )
+			return 0;
+
+		id = ent->id;
+	}
+}
+
+static int tcam_enum_links(int fd, const struct media_entity_desc* ent,
+			   struct media_link_desc** links)
+{
+	struct media_links_enum		le;
+	struct media_pad_desc*		pads;
+	int		ret;
+
+	*links = calloc(ent->links + 1, sizeof(**links));
+	pads = calloc(ent->pads + 1, sizeof(*pads));
+	if ( NULL == *links || NULL == pads ) {
+		free(*links);
+		free(pads);
+		return -ENOMEM;
+	}
+
+	memset(&le, 0, sizeof(le));
+	le.entity	= ent->id;
+	le.pads		= pads;
+	le.links	= *links;
+
+	ret = tcam_ioctl(fd, MEDIA_IOC_ENUM_LINKS, &le);
+	free(pads);
+	if ( ret ) {
+		free(*links);
+		*links = NULL;
+		return ret;
+	}
+
+	return ent->links;
+}
+
+static int tcam_set_link(int fd, struct media_link_desc* link, int enable)
+{
+	uint32_t	flags = enable ? MEDIA_LNK_FL_ENABLED : 0;
+
+	if ( link->flags & MEDIA_LNK_FL_IMMUTABLE )
+		return 0;
+
+	if ( (link->flags & MEDIA_LNK_FL_ENABLED) == flags )
+		return 0;
+
+	link->flags = (link->flags & ~MEDIA_LNK_FL_ENABLED) | flags;
+
+	#ifdef TCAMLIB_DBG_MSG
+	printf("link %u:%u -> %u:%u [%d]\n", link->source.entity, link->source.index,
+	       link->sink.entity, link->sink.index, enable);
+	#endif
+
+	return tcam_ioctl(fd, MEDIA_IOC_SETUP_LINK, link);
+}
+
+/*
+ * sensor -> csi2 enabled, csi2:4 -> rp1-cfe-csi2_ch0:0 enabled and every
+ * other csi2 source link disabled. Other entities are left alone, unlike
+ * media-ctl -r.
+ */
+static int tcam_setup_links(int fd, const struct media_entity_desc* sensor,
+			    const struct media_entity_desc* csi2,
+			    const struct media_entity_desc* video)
+{
+	struct media_link_desc*		links;
+	struct media_link_desc*		target = NULL;
+	int		cnt, i, ret = 0;
+
+	cnt = tcam_enum_links(fd, sensor, &links);
+	if ( cnt < 0 )
+		return cnt;
+
+	for ( i = 0; i < cnt && 0 == ret; i++ ) {
+		if ( links[i].sink.entity == csi2->id )
+			ret = tcam_set_link(fd, &links[i], 1);
+	}
+	free(links);
+	if ( ret )
+		return ret;
+
+	cnt = tcam_enum_links(fd, csi2, &links);
+	if ( cnt < 0 )
+		return cnt;
+
+	//	먼저 다른 채널을 끊고 대상 링크를 연결
+	for ( i = 0; i < cnt && 0 == ret; i++ ) {
+		if ( links[i].source.entity != csi2->id )
+			continue;
+
+		if ( TCAM_CSI2_SOURCE_PAD == links[i].source.index &&
+		     links[i].sink.entity == video->id && 0 == links[i].sink.index ) {
+			target = &links[i];
+			continue;
+		}
+
+		ret = tcam_set_link(fd, &links[i], 0);
+	}
+
+	if ( 0 == ret )
+		ret = target ? tcam_set_link(fd, target, 1) : -ENOLINK;
+
+	free(links);
+
+	return ret;
+}
+
+static int tcam_subdev_fmt(const char* path, uint32_t pad, const TCAM_PIPE_CFG_T* cfg)
+{
+	struct v4l2_subdev_format	fmt;
+	int		fd, ret;
+
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if ( fd < 0 )
+		return -errno;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.which	= V4L2_SUBDEV_FORMAT_ACTIVE;
+	fmt.pad		= pad;
+
+	ret = tcam_ioctl(fd, VIDIOC_SUBDEV_G_FMT, &fmt);
+	if ( 0 == ret ) {
+		fmt.format.code		= cfg->mbus_code;
+		fmt.format.width	= cfg->width;
+		fmt.format.height	= cfg->height;
+		fmt.format.field	= V4L2_FIELD_NONE;
+
+		ret = tcam_ioctl(fd, VIDIOC_SUBDEV_S_FMT, &fmt);
+	}
+
+	if ( 0 == ret && (fmt.format.code != cfg->mbus_code ||
+			  fmt.format.width != cfg->width || fmt.format.height != cfg->height) ) {
+		fprintf(stderr, "%s pad %u: got %04x %ux%u\n", path, pad,
+			fmt.format.code, fmt.format.width, fmt.format.height);
+		ret = -EINVAL;
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+static int tcam_video_fmt(const char* path, const TCAM_PIPE_CFG_T* cfg)
+{
+	struct v4l2_format	fmt;
+	int		fd, ret;
+
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if ( fd < 0 )
+		return -errno;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type					= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width			= cfg->width;
+	fmt.fmt.pix.height			= cfg->height;
+	fmt.fmt.pix.pixelformat		= cfg->pixelformat;
+	fmt.fmt.pix.field			= V4L2_FIELD_NONE;
+	fmt.fmt.pix.colorspace		= V4L2_COLORSPACE_REC709;
+	fmt.fmt.pix.ycbcr_enc		= V4L2_YCBCR_ENC_709;
+	fmt.fmt.pix.xfer_func		= V4L2_XFER_FUNC_709;
+	fmt.fmt.pix.quantization	= V4L2_QUANTIZATION_FULL_RANGE;
+
+	ret = tcam_ioctl(fd, VIDIOC_S_FMT, &fmt);
+
+	if ( 0 == ret && (fmt.fmt.pix.pixelformat != cfg->pixelformat ||
+			  fmt.fmt.pix.width != cfg->width || fmt.fmt.pix.height != cfg->height) ) {
+		fprintf(stderr, "%s: got %.4s %ux%u\n", path,
+			(const char*)&fmt.fmt.pix.pixelformat, fmt.fmt.pix.width, fmt.fmt.pix.height);
+		ret = -EINVAL;
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+void tcam_media_default_cfg(int raw, int bus, TCAM_PIPE_CFG_T* cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+
+	//	media_setting_rpi5.sh 와 같은 기본값
+	if ( raw ) {
+		snprintf(cfg->sensor, sizeof(cfg->sensor), "traw %d-0054", bus);
+		cfg->mbus_code		= MEDIA_BUS_FMT_UYVY8_1X16;
+		cfg->pixelformat	= V4L2_PIX_FMT_UYVY;
+		cfg->width			= 384;
+		cfg->height			= 289;
+	}
+	else {
+		snprintf(cfg->sensor, sizeof(cfg->sensor), "tvdo %d-0054", bus);
+		cfg->mbus_code		= MEDIA_BUS_FMT_YUYV8_1X16;
+		cfg->pixelformat	= V4L2_PIX_FMT_YUYV;
+		cfg->width			= 384;
+		cfg->height			= 288;
+	}
+}
+
+int tcam_media_find(const TCAM_PIPE_CFG_T* cfg, TCAM_PIPE_T* pipe)
+{
+	struct media_entity_desc	ent;
+	char		path[TCAM_PATH_MAX];
+	int			fd, i, found;
+
+	for ( i = 0; i < TCAM_MEDIA_MAX_DEV; i++ ) {
+		snprintf(path, sizeof(path), "/dev/media%d", i);
+
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if ( fd < 0 )
+			continue;
+
+		found = (0 == tcam_find_entity(fd, cfg->sensor, &ent));
+		close(fd);
+
+		if ( found ) {
+			memset(pipe, 0, sizeof(*pipe));
+			snprintf(pipe->media_dev, sizeof(pipe->media_dev), "%s", path);
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+int tcam_media_setup(const TCAM_PIPE_CFG_T* cfg, TCAM_PIPE_T* pipe)
+{
+	struct media_entity_desc	sensor, csi2, video;
+	int		fd, ret;
+
+	if ( '\0' == pipe->media_dev[0] ) {
+		ret = tcam_media_find(cfg, pipe);
+		if ( ret )
+			return ret;
+	}
+
+	fd = open(pipe->media_dev, O_RDWR | O_CLOEXEC);
+	if ( fd < 0 )
+		return -errno;
+
+	ret = tcam_find_entity(fd, cfg->sensor, &sensor);
+	if ( 0 == ret )
+		ret = tcam_find_entity(fd, TCAM_CSI2_ENTITY, &csi2);
+	if ( 0 == ret )
+		ret = tcam_find_entity(fd, TCAM_VIDEO_ENTITY, &video);
+	if ( ret )
+		goto out;
+
+	ret = tcam_devnode_path(&sensor, pipe->subdev, sizeof(pipe->subdev));
+	if ( 0 == ret )
+		ret = tcam_devnode_path(&csi2, pipe->csi2_subdev, sizeof(pipe->csi2_subdev));
+	if ( 0 == ret )
+		ret = tcam_devnode_path(&video, pipe->video_dev, sizeof(pipe->video_dev));
+	if ( ret )
+		goto out;
+
+	ret = tcam_setup_links(fd, &sensor, &csi2, &video);
+	if ( ret )
+		goto out;
+
+	ret = tcam_subdev_fmt(pipe->subdev, 0, cfg);
+	if ( 0 == ret )
+		ret = tcam_subdev_fmt(pipe->csi2_subdev, TCAM_CSI2_SINK_PAD, cfg);
+	if ( 0 == ret )
+		ret = tcam_subdev_fmt(pipe->csi2_subdev, TCAM_CSI2_SOURCE_PAD, cfg);
+	if ( 0 == ret )
+		ret = tcam_video_fmt(pipe->video_dev, cfg);
+
+out:
+	close(fd);
+
+	return ret;
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Media pipeline setup for COX LWIR cameras on the RP1 CFE.
+ *
+ * sensor (traw/tvdo) -> csi2 -> rp1-cfe-csi2_ch0, configured with the
+ * media controller and subdev ioctls directly.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_MEDIA_H__
+#define __TCAM_MEDIA_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_RAW_I2C_BUS		(10)
+#define		TCAM_VDO_I2C_BUS		(11)
+
+#define		TCAM_CSI2_ENTITY		"csi2"
+#define		TCAM_CSI2_SINK_PAD		(0)
+#define		TCAM_CSI2_SOURCE_PAD	(4)
+#define		TCAM_VIDEO_ENTITY		"rp1-cfe-csi2_ch0"
+
+#define		TCAM_PATH_MAX			(64)
+
+typedef struct __tcam_pipe_cfg__ {
+	char		sensor[32];			//	entity name, e.g. "traw 10-0054"
+	uint32_t	mbus_code;			//	MEDIA_BUS_FMT_*
+	uint32_t	pixelformat;		//	V4L2_PIX_FMT_*
+	uint32_t	width;
+	uint32_t	height;
+} TCAM_PIPE_CFG_T;
+
+typedef struct __tcam_pipe__ {
+	char		media_dev[TCAM_PATH_MAX];
+	char		video_dev[TCAM_PATH_MAX];		//	capture node
+	char		subdev[TCAM_PATH_MAX];			//	sensor subdev, camera controls
+	char		csi2_subdev[TCAM_PATH_MAX];
+} TCAM_PIPE_T;
+
+/* fill cfg with the defaults for the raw (1) or video (0) camera on bus */
+void tcam_media_default_cfg(int raw, int bus, TCAM_PIPE_CFG_T* cfg);
+
+/* locate the media device holding cfg->sensor, 0 or -errno */
+int tcam_media_find(const TCAM_PIPE_CFG_T* cfg, TCAM_PIPE_T* pipe);
+
+/* links and formats for the whole pipeline in one pass, 0 or -errno */
+int tcam_media_setup(const TCAM_PIPE_CFG_T* cfg, TCAM_PIPE_T* pipe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_MEDIA_H__ */
@@ -0,0 +1,509 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Palette colorization, see tcam_palette.h.
+ *
+ * arm64: 8 bit sources go through NEON table lookups, the 256 byte
+ *        channel planes split over four TBL/TBX of 64 bytes, and are
+ *        stored interleaved with ST3/ST4 (or zipped and STNP when
+ *        streaming, RGB888 goes through a 96 byte ST3 bounce buffer).
+ *        14 bit sources are scalar lookups into the 64 KiB packed LUT,
+ *        NEON has no gather.
+ * x86  : AVX2 gathers from the packed tables for 32 bpp outputs, scalar
+ *        otherwise, MOVNT stores when streaming. RGB888 streams 4 pixels
+ *        as 3 MOVNTI words.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define		TCAM_PAL_X86
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define		TCAM_PAL_NEON
+#endif
+
+#include "tcam_palette.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "packed palette entries assume a little endian host"
+#endif
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_PAL_MASK			(TCAM_PAL_BINS - 1)
+
+typedef struct __tcam_pal_stop__ {
+	uint8_t		pos;
+	uint8_t		r, g, b;
+} TCAM_PAL_STOP_T;
+
+typedef struct __tcam_pal_def__ {
+	const TCAM_PAL_STOP_T*	stops;
+	int						count;
+} TCAM_PAL_DEF_T;
+
+struct __tcam_palette__ {
+	eTCAM_PAL_OUT	out;
+	uint32_t		bpp;
+
+	//	NEON TBL 용 channel plane
+	uint8_t			r[256] __attribute__((aligned(64)));
+	uint8_t			g[256] __attribute__((aligned(64)));
+	uint8_t			b[256] __attribute__((aligned(64)));
+
+	//	output byte order 로 pack 된 entry
+	uint32_t		pal[256] __attribute__((aligned(64)));
+	uint32_t		lut[TCAM_PAL_BINS] __attribute__((aligned(64)));
+};
+
+static const TCAM_PAL_STOP_T	g_pal_white_hot[] = {
+	{   0,   0,   0,   0 },
+	{ 255, 255, 255, 255 },
+};
+
+static const TCAM_PAL_STOP_T	g_pal_black_hot[] = {
+	{   0, 255, 255, 255 },
+	{ 255,   0,   0,   0 },
+};
+
+static const TCAM_PAL_STOP_T	g_pal_iron[] = {
+	{   0,   0,   0,   0 },
+	{  50,  60,   0, 140 },
+	{ 100, 170,  20, 130 },
+	{ 155, 230,  80,  20 },
+	{ 205, 255, 180,   0 },
+	{ 255, 255, 255, 230 },
+};
+
+static const TCAM_PAL_STOP_T	g_pal_rainbow[] = {
+	{   0,   0,   0, 130 },
+	{  40,   0,   0, 255 },
+	{  90,   0, 200, 255 },
+	{ 128,   0, 255,  80 },
+	{ 165, 255, 255,   0 },
+	{ 215, 255, 100,   0 },
+	{ 255, 255,   0,   0 },
+};
+
+#define		PAL_DEF(t)		{ t, (int)(sizeof(t) / sizeof(t[0])) }
+
+static const TCAM_PAL_DEF_T		g_pal_defs[] = {
+	[TCAM_PAL_WHITE_HOT]	= PAL_DEF(g_pal_white_hot),
+	[TCAM_PAL_BLACK_HOT]	= PAL_DEF(g_pal_black_hot),
+	[TCAM_PAL_IRON]			= PAL_DEF(g_pal_iron),
+	[TCAM_PAL_RAINBOW]		= PAL_DEF(g_pal_rainbow),
+};
+
+static int	g_pal_avx2 = -1;
+
+
+uint32_t tcam_palette_bpp(eTCAM_PAL_OUT out)
+{
+	return TCAM_PAL_RGB888 == out ? 3 : 4;
+}
+
+static uint32_t tcam_pal_pack(eTCAM_PAL_OUT out, uint8_t r, uint8_t g, uint8_t b)
+{
+	switch ( out ) {
+	case TCAM_PAL_RGBA8888:	return r | (g << 8) | (b << 16) | (0xffu << 24);
+	case TCAM_PAL_XRGB8888:	return b | (g << 8) | (r << 16) | (0xffu << 24);
+	default:				return r | (g << 8) | (b << 16);
+	}
+}
+
+static void tcam_pal_build(TCAM_PALETTE_T* pal, const TCAM_PAL_DEF_T* def)
+{
+	const TCAM_PAL_STOP_T	*lo, *hi;
+	int		i, s = 0, span, t;
+
+	for ( i = 0; i < 256; i++ ) {
+		while ( s + 2 < def->count && i > def->stops[s + 1].pos )
+			s++;
+
+		lo		= &def->stops[s];
+		hi		= &def->stops[s + 1];
+		span	= hi->pos - lo->pos;
+		t		= i - lo->pos;
+
+		pal->r[i]	= (uint8_t)(lo->r + ((hi->r - lo->r) * t + span / 2) / span);
+		pal->g[i]	= (uint8_t)(lo->g + ((hi->g - lo->g) * t + span / 2) / span);
+		pal->b[i]	= (uint8_t)(lo->b + ((hi->b - lo->b) * t + span / 2) / span);
+		pal->pal[i]	= tcam_pal_pack(pal->out, pal->r[i], pal->g[i], pal->b[i]);
+	}
+}
+
+int tcam_palette_create(TCAM_PALETTE_T** out, eTCAM_PALETTE id, eTCAM_PAL_OUT fmt)
+{
+	TCAM_PALETTE_T*	pal;
+
+	*out = NULL;
+
+	if ( (unsigned)id >= TCAM_NUM_PALETTES || (unsigned)fmt >= TCAM_NUM_PAL_OUTS )
+		return -EINVAL;
+
+	pal = aligned_alloc(64, (sizeof(*pal) + 63) & ~(size_t)63);
+	if ( NULL == pal )
+		return -ENOMEM;
+
+	memset(pal, 0, sizeof(*pal));
+	pal->out = fmt;
+	pal->bpp = tcam_palette_bpp(fmt);
+
+	tcam_pal_build(pal, &g_pal_defs[id]);
+	tcam_palette_set_window(pal, 0, TCAM_PAL_MASK);
+
+	if ( g_pal_avx2 < 0 ) {
+#ifdef TCAM_PAL_X86
+		__atomic_store_n(&g_pal_avx2, __builtin_cpu_supports("avx2") ? 1 : 0, __ATOMIC_RELAXED);
+#else
+		__atomic_store_n(&g_pal_avx2, 0, __ATOMIC_RELAXED);
+#endif
+	}
+
+	*out = pal;
+
+	return 0;
+}
+
+void tcam_palette_destroy(TCAM_PALETTE_T* pal)
+{
+	free(pal);
+}
+
+void tcam_palette_set_window(TCAM_PALETTE_T* pal, uint16_t lo, uint16_t hi)
+{
+	uint32_t	c, span;
+
+	lo &= TCAM_PAL_MASK;
+	hi &= TCAM_PAL_MASK;
+	if ( hi <= lo )
+		hi = lo + 1;
+	span = hi - lo;
+
+	for ( c = 0; c < TCAM_PAL_BINS; c++ ) {
+		if ( c <= lo )
+			pal->lut[c] = pal->pal[0];
+		else if ( c >= hi )
+			pal->lut[c] = pal->pal[255];
+		else
+			pal->lut[c] = pal->pal[((c - lo) * 255 + span / 2) / span];
+	}
+}
+
+void tcam_palette_set_map(TCAM_PALETTE_T* pal, const uint8_t* map)
+{
+	uint32_t	c;
+
+	for ( c = 0; c < TCAM_PAL_BINS; c++ )
+		pal->lut[c] = pal->pal[map[c]];
+}
+
+static inline void tcam_pal_put(uint8_t* dst, uint32_t v, uint32_t bpp, int stream)
+{
+#ifdef TCAM_PAL_X86
+	if ( stream && 4 == bpp && 0 == ((uintptr_t)dst & 3) ) {
+		_mm_stream_si32((int*)dst, (int)v);
+		return;
+	}
+#else
+	(void)stream;
+#endif
+
+	memcpy(dst, &v, bpp);
+}
+
+static void tcam_pal_line8_scalar(const TCAM_PALETTE_T* pal, const uint8_t* src, uint8_t* dst,
+				  uint32_t width, int stream)
+{
+	uint32_t	x;
+
+	for ( x = 0; x < width; x++ )
+		tcam_pal_put(dst + x * pal->bpp, pal->pal[src[x]], pal->bpp, stream);
+}
+
+static void tcam_pal_line16_scalar(const TCAM_PALETTE_T* pal, const uint16_t* src, uint8_t* dst,
+				   uint32_t width, int stream)
+{
+	uint32_t	x;
+
+	for ( x = 0; x < width; x++ )
+		tcam_pal_put(dst + x * pal->bpp, pal->lut[src[x] & TCAM_PAL_MASK], pal->bpp, stream);
+}
+
+#ifdef TCAM_PAL_X86
+static inline uint32_t tcam_pal_pix(const TCAM_PALETTE_T* pal, const void* src, int src16, uint32_t x)
+{
+	return src16 ? pal->lut[((const uint16_t*)src)[x] & TCAM_PAL_MASK] : pal->pal[((const uint8_t*)src)[x]];
+}
+
+/* RGB888 streaming, src as in tcam_pal_line_avx2 */
+static void tcam_pal_line_stream3(const TCAM_PALETTE_T* pal, const void* src, int src16, uint8_t* dst,
+				  uint32_t width)
+{
+	uint32_t	p0, p1, p2, p3;
+	uint32_t	x = 0;
+
+	//	MOVNTI 는 4 byte 정렬, 3 pixel 이내에 맞춰진다
+	for ( ; x < width && ((uintptr_t)(dst + 3 * x) & 3); x++ )
+		tcam_pal_put(dst + 3 * x, tcam_pal_pix(pal, src, src16, x), 3, 0);
+
+	//	R,G,B 0 entry 4 개 = 12 byte = 3 word
+	for ( ; x + 4 <= width; x += 4 ) {
+		p0	= tcam_pal_pix(pal, src, src16, x);
+		p1	= tcam_pal_pix(pal, src, src16, x + 1);
+		p2	= tcam_pal_pix(pal, src, src16, x + 2);
+		p3	= tcam_pal_pix(pal, src, src16, x + 3);
+
+		_mm_stream_si32((int*)(dst + 3 * x),     (int)(p0 | (p1 << 24)));
+		_mm_stream_si32((int*)(dst + 3 * x + 4), (int)((p1 >> 8) | (p2 << 16)));
+		_mm_stream_si32((int*)(dst + 3 * x + 8), (int)((p2 >> 16) | (p3 << 8)));
+	}
+
+	for ( ; x < width; x++ )
+		tcam_pal_put(dst + 3 * x, tcam_pal_pix(pal, src, src16, x), 3, 0);
+}
+
+/* 32 bpp only, src is uint8_t (src16 0) or uint16_t (src16 1) */
+__attribute__((target("avx2")))
+static void tcam_pal_line_avx2(const TCAM_PALETTE_T* pal, const void* src, int src16, uint8_t* dst,
+			       uint32_t width, int stream)
+{
+	const uint8_t*	s8 = src;
+	const uint16_t*	s16 = src;
+	const __m256i	mask = _mm256_set1_epi32(TCAM_PAL_MASK);
+	__m256i		idx, v;
+	uint32_t	x = 0;
+
+	//	streaming store 는 32 byte 정렬 필요
+	if ( stream ) {
+		for ( ; x < width && ((uintptr_t)(dst + 4 * x) & 31); x++ )
+			tcam_pal_put(dst + 4 * x, src16 ? pal->lut[s16[x] & TCAM_PAL_MASK] : pal->pal[s8[x]], 4, 1);
+	}
+
+	for ( ; x + 8 <= width; x += 8 ) {
+		if ( src16 ) {
+			idx	= _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s16 + x))), mask);
+			v	= _mm256_i32gather_epi32((const int*)pal->lut, idx, 4);
+		} else {
+			idx	= _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s8 + x)));
+			v	= _mm256_i32gather_epi32((const int*)pal->pal, idx, 4);
+		}
+
+		if ( stream )
+			_mm256_stream_si256((__m256i*)(dst + 4 * x), v);
+		else
+			_mm256_storeu_si256((__m256i*)(dst + 4 * x), v);
+	}
+
+	if ( src16 )
+		tcam_pal_line16_scalar(pal, s16 + x, dst + 4 * x, width - x, stream);
+	else
+		tcam_pal_line8_scalar(pal, s8 + x, dst + 4 * x, width - x, stream);
+}
+#endif
+
+#ifdef TCAM_PAL_NEON
+/* 256 entry byte table as four 64 byte TBL/TBX ranges */
+static inline uint8x16_t tcam_pal_tbl256(const uint8_t* t, uint8x16_t idx)
+{
+	uint8x16_t	v;
+
+	v = vqtbl4q_u8(vld1q_u8_x4(t), idx);
+	v = vqtbx4q_u8(v, vld1q_u8_x4(t + 64), vsubq_u8(idx, vdupq_n_u8(64)));
+	v = vqtbx4q_u8(v, vld1q_u8_x4(t + 128), vsubq_u8(idx, vdupq_n_u8(128)));
+	v = vqtbx4q_u8(v, vld1q_u8_x4(t + 192), vsubq_u8(idx, vdupq_n_u8(192)));
+
+	return v;
+}
+
+static inline void tcam_pal_stnp(uint8_t* p, uint16x8_t a, uint16x8_t b)
+{
+	__asm__ volatile("stnp %q0, %q1, [%2]" : : "w"(a), "w"(b), "r"(p) : "memory");
+}
+
+/* 16 pixels of 4 byte channels c0..c3 in memory order, zipped for STNP */
+static inline void tcam_pal_stream4(uint8_t* dst, uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint8x16_t c3)
+{
+	uint8x16x2_t	lo = vzipq_u8(c0, c1);
+	uint8x16x2_t	hi = vzipq_u8(c2, c3);
+	uint16x8x2_t	p0 = vzipq_u16(vreinterpretq_u16_u8(lo.val[0]), vreinterpretq_u16_u8(hi.val[0]));
+	uint16x8x2_t	p1 = vzipq_u16(vreinterpretq_u16_u8(lo.val[1]), vreinterpretq_u16_u8(hi.val[1]));
+
+	tcam_pal_stnp(dst, p0.val[0], p0.val[1]);
+	tcam_pal_stnp(dst + 32, p1.val[0], p1.val[1]);
+}
+
+/* 32 RGB888 pixels, 96 bytes of buf as three STNP pairs */
+static inline void tcam_pal_stream96(uint8_t* dst, const uint8_t* buf)
+{
+	int		i;
+
+	for ( i = 0; i < 96; i += 32 )
+		tcam_pal_stnp(dst + i, vreinterpretq_u16_u8(vld1q_u8(buf + i)),
+			      vreinterpretq_u16_u8(vld1q_u8(buf + i + 16)));
+}
+
+/* RGB888 streaming, ST3 has no non-temporal form so bounce through buf */
+static void tcam_pal_line8_neon_stream3(const TCAM_PALETTE_T* pal, const uint8_t* src, uint8_t* dst,
+					uint32_t width)
+{
+	uint8_t			buf[96] __attribute__((aligned(16)));
+	uint8x16_t		idx;
+	uint32_t		x = 0, h;
+
+	for ( ; x + 32 <= width; x += 32 ) {
+		for ( h = 0; h < 2; h++ ) {
+			idx = vld1q_u8(src + x + 16 * h);
+			vst3q_u8(buf + 48 * h, (uint8x16x3_t){ { tcam_pal_tbl256(pal->r, idx),
+								 tcam_pal_tbl256(pal->g, idx),
+								 tcam_pal_tbl256(pal->b, idx) } });
+		}
+
+		tcam_pal_stream96(dst + 3 * x, buf);
+	}
+
+	tcam_pal_line8_scalar(pal, src + x, dst + 3 * x, width - x, 0);
+}
+
+static void tcam_pal_line8_neon(const TCAM_PALETTE_T* pal, const uint8_t* src, uint8_t* dst,
+				uint32_t width, int stream)
+{
+	const uint8x16_t	opaque = vdupq_n_u8(0xff);
+	uint8x16_t		idx, r, g, b;
+	uint32_t		x = 0;
+
+	for ( ; x + 16 <= width; x += 16 ) {
+		idx	= vld1q_u8(src + x);
+		r	= tcam_pal_tbl256(pal->r, idx);
+		g	= tcam_pal_tbl256(pal->g, idx);
+		b	= tcam_pal_tbl256(pal->b, idx);
+
+		switch ( pal->out ) {
+		case TCAM_PAL_RGBA8888:
+			if ( stream )
+				tcam_pal_stream4(dst + 4 * x, r, g, b, opaque);
+			else
+				vst4q_u8(dst + 4 * x, (uint8x16x4_t){ { r, g, b, opaque } });
+			break;
+		case TCAM_PAL_XRGB8888:
+			if ( stream )
+				tcam_pal_stream4(dst + 4 * x, b, g, r, opaque);
+			else
+				vst4q_u8(dst + 4 * x, (uint8x16x4_t){ { b, g, r, opaque } });
+			break;
+		default:
+			vst3q_u8(dst + 3 * x, (uint8x16x3_t){ { r, g, b } });
+			break;
+		}
+	}
+
+	tcam_pal_line8_scalar(pal, src + x, dst + pal->bpp * x, width - x, stream);
+}
+
+/* 32 bpp streaming, 8 scalar lookups per STNP pair */
+static void tcam_pal_line16_neon_stream(const TCAM_PALETTE_T* pal, const uint16_t* src, uint8_t* dst,
+				        uint32_t width)
+{
+	uint32_t	v[8];
+	uint32_t	x = 0, i;
+
+	for ( ; x + 8 <= width; x += 8 ) {
+		for ( i = 0; i < 8; i++ )
+			v[i] = pal->lut[src[x + i] & TCAM_PAL_MASK];
+
+		tcam_pal_stnp(dst + 4 * x, vreinterpretq_u16_u32(vld1q_u32(v)),
+			      vreinterpretq_u16_u32(vld1q_u32(v + 4)));
+	}
+
+	tcam_pal_line16_scalar(pal, src + x, dst + 4 * x, width - x, 0);
+}
+
+/* RGB888 streaming, 32 scalar lookups per bounce buffer */
+static void tcam_pal_line16_neon_stream3(const TCAM_PALETTE_T* pal, const uint16_t* src, uint8_t* dst,
+					 uint32_t width)
+{
+	uint8_t		buf[96] __attribute__((aligned(16)));
+	uint32_t	x = 0, i;
+
+	for ( ; x + 32 <= width; x += 32 ) {
+		for ( i = 0; i < 32; i++ )
+			memcpy(buf + 3 * i, &pal->lut[src[x + i] & TCAM_PAL_MASK], 3);
+
+		tcam_pal_stream96(dst + 3 * x, buf);
+	}
+
+	tcam_pal_line16_scalar(pal, src + x, dst + 3 * x, width - x, 0);
+}
+#endif
+
+void tcam_palette_apply8(const TCAM_PALETTE_T* pal, const uint8_t* src, uint32_t width, uint32_t height,
+			 uint8_t* dst, size_t dst_stride, int flags)
+{
+	int			stream = !!(flags & TCAM_PAL_STREAM);
+	uint32_t	y;
+
+	for ( y = 0; y < height; y++, src += width, dst += dst_stride ) {
+#if defined(TCAM_PAL_X86)
+		if ( g_pal_avx2 > 0 && 4 == pal->bpp )
+			tcam_pal_line_avx2(pal, src, 0, dst, width, stream);
+		else if ( stream && 3 == pal->bpp )
+			tcam_pal_line_stream3(pal, src, 0, dst, width);
+		else
+			tcam_pal_line8_scalar(pal, src, dst, width, stream);
+#elif defined(TCAM_PAL_NEON)
+		if ( stream && 3 == pal->bpp )
+			tcam_pal_line8_neon_stream3(pal, src, dst, width);
+		else
+			tcam_pal_line8_neon(pal, src, dst, width, stream);
+#else
+		tcam_pal_line8_scalar(pal, src, dst, width, stream);
+#endif
+	}
+
+#ifdef TCAM_PAL_X86
+	//	MOVNT 는 weakly ordered, 다른 agent 에게 넘기기 전에 fence
+	if ( stream )
+		_mm_sfence();
+#endif
+}
+
+void tcam_palette_apply16(const TCAM_PALETTE_T* pal, const uint16_t* src, uint32_t width, uint32_t height,
+			  uint8_t* dst, size_t dst_stride, int flags)
+{
+	int			stream = !!(flags & TCAM_PAL_STREAM);
+	uint32_t	y;
+
+	for ( y = 0; y < height; y++, src += width, dst += dst_stride ) {
+#if defined(TCAM_PAL_X86)
+		if ( g_pal_avx2 > 0 && 4 == pal->bpp )
+			tcam_pal_line_avx2(pal, src, 1, dst, width, stream);
+		else if ( stream && 3 == pal->bpp )
+			tcam_pal_line_stream3(pal, src, 1, dst, width);
+		else
+			tcam_pal_line16_scalar(pal, src, dst, width, stream);
+#elif defined(TCAM_PAL_NEON)
+		if ( stream && 4 == pal->bpp )
+			tcam_pal_line16_neon_stream(pal, src, dst, width);
+		else if ( stream && 3 == pal->bpp )
+			tcam_pal_line16_neon_stream3(pal, src, dst, width);
+		else
+			tcam_pal_line16_scalar(pal, src, dst, width, stream);
+#else
+		tcam_pal_line16_scalar(pal, src, dst, width, stream);
+#endif
+	}
+
+#ifdef TCAM_PAL_X86
+	if ( stream )
+		_mm_sfence();
+#endif
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Palette colorization of 8 bit (AGC output, tcam-vdo luma) and 14 bit
+ * (raw count) frames into RGB888, RGBA8888 or DRM XRGB8888.
+ *
+ *   8 bit : 256 entry palette
+ *   14 bit: 16K entry LUT, the palette over a linear count window
+ *           (tcam_palette_set_window) or composed with an AGC LUT
+ *           (tcam_palette_set_map), one lookup per pixel either way
+ *
+ * Byte order in memory: RGB888 R,G,B  RGBA8888 R,G,B,A  XRGB8888 B,G,R,X
+ * (DRM_FORMAT_XRGB8888, little endian 0xXXRRGGBB).
+ *
+ * TCAM_PAL_STREAM writes with non-temporal stores, for destinations that
+ * are not read back by the CPU (scanout buffers, dmabufs for the GPU).
+ * Without it the output stays in cache for the next stage. It applies to
+ * every output format; RGB888 lines are streamed in groups of 4 (x86) or
+ * 32 (arm64) pixels, the remainder with plain stores.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_PALETTE_H__
+#define __TCAM_PALETTE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_PAL_BINS			(16384)		//	14 bit counts
+
+//	apply flags
+#define		TCAM_PAL_STREAM			(1 << 0)	//	non-temporal stores
+
+typedef enum __tcam_palette_id__ {
+	TCAM_PAL_WHITE_HOT = 0,
+	TCAM_PAL_BLACK_HOT,
+	TCAM_PAL_IRON,
+	TCAM_PAL_RAINBOW,
+	TCAM_NUM_PALETTES,
+} eTCAM_PALETTE;
+
+typedef enum __tcam_pal_out__ {
+	TCAM_PAL_RGB888 = 0,
+	TCAM_PAL_RGBA8888,
+	TCAM_PAL_XRGB8888,
+	TCAM_NUM_PAL_OUTS,
+} eTCAM_PAL_OUT;
+
+typedef struct __tcam_palette__ TCAM_PALETTE_T;
+
+/* 14 bit LUT starts as the full 0..16383 window. 0, -EINVAL or -ENOMEM */
+int tcam_palette_create(TCAM_PALETTE_T** pal, eTCAM_PALETTE id, eTCAM_PAL_OUT out);
+void tcam_palette_destroy(TCAM_PALETTE_T* pal);
+
+/* bytes per output pixel */
+uint32_t tcam_palette_bpp(eTCAM_PAL_OUT out);
+
+/* 14 bit LUT: lo and below first color, hi and above last, linear between */
+void tcam_palette_set_window(TCAM_PALETTE_T* pal, uint16_t lo, uint16_t hi);
+
+/* 14 bit LUT: palette[map[count]], map has TCAM_PAL_BINS entries (tcam_agc_lut) */
+void tcam_palette_set_map(TCAM_PALETTE_T* pal, const uint8_t* map);
+
+/* width x height source pixels, contiguous lines, dst_stride in bytes */
+void tcam_palette_apply8(const TCAM_PALETTE_T* pal, const uint8_t* src, uint32_t width, uint32_t height,
+			 uint8_t* dst, size_t dst_stride, int flags);
+void tcam_palette_apply16(const TCAM_PALETTE_T* pal, const uint16_t* src, uint32_t width, uint32_t height,
+			  uint8_t* dst, size_t dst_stride, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_PALETTE_H__ */
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Radiometric conversion, see tcam_radio.h.
+ *
+ * Every 14 bit count has its own LUT entry, so there is nothing to
+ * interpolate. A 32 KiB table stays in L1 on the Cortex-A76, and scalar
+ * loads beat emulated gathers on NEON. AVX2 uses real gathers.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define		TCAM_RADIO_X86
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define		TCAM_RADIO_NEON
+#endif
+
+#include "tcam_radio.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_RADIO_MASK			(TCAM_RADIO_LUT_SIZE - 1)
+#define		TCAM_RADIO_CK_MAX		(65535)
+#define		TCAM_RADIO_CHUNK		(512)		//	apply_k() staging, stays in L1
+
+typedef struct __tcam_radio_lut__ {
+	int32_t		bucket;			//	-1 empty
+	uint32_t	built;			//	entries done
+	uint32_t	stamp;			//	last use, LRU
+	//	+2 : 32 bit gather of the last entry reads one past it
+	uint16_t	ck[TCAM_RADIO_LUT_SIZE + 2] __attribute__((aligned(64)));
+} TCAM_RADIO_LUT_T;
+
+struct __tcam_radio__ {
+	TCAM_RADIO_CAL_T	cal;
+	TCAM_RADIO_LUT_T	luts[TCAM_RADIO_CACHE];
+	TCAM_RADIO_LUT_T*	active;
+	TCAM_RADIO_LUT_T*	building;
+	uint32_t			clock;
+};
+
+static void (*g_radio_apply)(const uint16_t* lut, const uint16_t* counts, uint16_t* out, size_t n);
+
+
+void tcam_radio_default_cal(TCAM_RADIO_CAL_T* cal)
+{
+	memset(cal, 0, sizeof(*cal));
+
+	//	약 -65 ~ +85 'C 범위, 303.15 K FPA 에서 room 7000 count
+	cal->planck_r		= 933600.0;
+	cal->planck_b		= 1428.0;
+	cal->planck_f		= 1.0;
+	cal->planck_o		= -1000.0;
+	cal->r_per_k		= 0.0;
+	cal->o_per_k		= 25.0;
+	cal->fpa_ref_ck		= 30315;
+	cal->bucket_ck		= 50;
+	cal->emissivity		= 1.0;
+	cal->reflected_k	= 293.15;
+}
+
+static int tcam_radio_check_cal(const TCAM_RADIO_CAL_T* cal)
+{
+	if ( cal->planck_r <= 0.0 || cal->planck_b <= 0.0 || 0 == cal->bucket_ck ||
+	     cal->emissivity <= 0.0 || cal->emissivity > 1.0 || cal->reflected_k <= 0.0 )
+		return -EINVAL;
+
+	return 0;
+}
+
+/* LUT entries [from, to) for the FPA temperature at the bucket center */
+static void tcam_radio_build(const TCAM_RADIO_CAL_T* cal, TCAM_RADIO_LUT_T* lut,
+			     uint32_t from, uint32_t to)
+{
+	double		fpa_k, dfpa, r, o, e, sig_refl, sig, t;
+	uint32_t	i;
+
+	fpa_k	= ((double)lut->bucket * cal->bucket_ck + cal->bucket_ck / 2.0) / 100.0;
+	dfpa	= fpa_k - cal->fpa_ref_ck / 100.0;
+	r		= cal->planck_r * (1.0 + cal->r_per_k * dfpa);
+	o		= cal->planck_o + cal->o_per_k * dfpa;
+	e		= cal->emissivity;
+
+	sig_refl = r / (exp(cal->planck_b / cal->reflected_k) - cal->planck_f);
+
+	for ( i = from; i < to; i++ ) {
+		sig = ((double)i - o - (1.0 - e) * sig_refl) / e;
+
+		if ( sig <= 0.0 ) {
+			lut->ck[i] = 0;
+			continue;
+		}
+
+		t = r / sig + cal->planck_f;
+		t = t > 1.0 ? cal->planck_b / log(t) * 100.0 + 0.5 : TCAM_RADIO_CK_MAX;
+
+		lut->ck[i] = t >= TCAM_RADIO_CK_MAX ? TCAM_RADIO_CK_MAX : (uint16_t)t;
+	}
+
+	lut->built = to;
+	if ( TCAM_RADIO_LUT_SIZE == to )
+		lut->ck[TCAM_RADIO_LUT_SIZE] = lut->ck[TCAM_RADIO_LUT_SIZE + 1] = 0;
+}
+
+static TCAM_RADIO_LUT_T* tcam_radio_cached(TCAM_RADIO_T* radio, int32_t bucket)
+{
+	int		i;
+
+	for ( i = 0; i < TCAM_RADIO_CACHE; i++ ) {
+		if ( bucket == radio->luts[i].bucket && TCAM_RADIO_LUT_SIZE == radio->luts[i].built )
+			return &radio->luts[i];
+	}
+
+	return NULL;
+}
+
+static TCAM_RADIO_LUT_T* tcam_radio_victim(TCAM_RADIO_T* radio)
+{
+	TCAM_RADIO_LUT_T*	victim = NULL;
+	int		i;
+
+	for ( i = 0; i < TCAM_RADIO_CACHE; i++ ) {
+		if ( &radio->luts[i] == radio->active )
+			continue;
+		if ( NULL == victim || radio->luts[i].bucket < 0 || radio->luts[i].stamp < victim->stamp )
+			victim = &radio->luts[i];
+		if ( victim->bucket < 0 )
+			break;
+	}
+
+	return victim;
+}
+
+static void tcam_radio_activate(TCAM_RADIO_T* radio, TCAM_RADIO_LUT_T* lut)
+{
+	radio->active	= lut;
+	lut->stamp		= ++radio->clock;
+}
+
+static void tcam_radio_reset(TCAM_RADIO_T* radio)
+{
+	int		i;
+
+	for ( i = 0; i < TCAM_RADIO_CACHE; i++ ) {
+		radio->luts[i].bucket	= -1;
+		radio->luts[i].built	= 0;
+		radio->luts[i].stamp	= 0;
+	}
+
+	radio->active	= NULL;
+	radio->building	= NULL;
+}
+
+static void tcam_radio_apply_scalar(const uint16_t* lut, const uint16_t* counts, uint16_t* out, size_t n)
+{
+	size_t	i;
+
+	for ( i = 0; i < n; i++ )
+		out[i] = lut[counts[i] & TCAM_RADIO_MASK];
+}
+
+#ifdef TCAM_RADIO_X86
+__attribute__((target("avx2")))
+static void tcam_radio_apply_avx2(const uint16_t* lut, const uint16_t* counts, uint16_t* out, size_t n)
+{
+	const __m256i	mask = _mm256_set1_epi32(TCAM_RADIO_MASK);
+	const __m256i	low = _mm256_set1_epi32(0xffff);
+	__m256i		ia, ib, ga, gb;
+	size_t		i = 0;
+
+	for ( ; i + 16 <= n; i += 16 ) {
+		ia = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i))), mask);
+		ib = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(counts + i + 8))), mask);
+
+		//	scale 2 : 32 bit load at the u16 entry, upper half belongs to the next one
+		ga = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, ia, 2), low);
+		gb = _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, ib, 2), low);
+
+		//	packus 는 128 bit lane 단위라서 순서를 다시 맞춘다
+		_mm256_storeu_si256((__m256i*)(out + i),
+			_mm256_permute4x64_epi64(_mm256_packus_epi32(ga, gb), 0xd8));
+	}
+
+	tcam_radio_apply_scalar(lut, counts + i, out + i, n - i);
+}
+#endif
+
+/* 0.01 K to K, SSE2 is baseline on x86_64 and NEON on arm64 */
+static void tcam_radio_ck_to_k(const uint16_t* ck, float* out, size_t n)
+{
+	size_t	i = 0;
+
+#if defined(TCAM_RADIO_X86) && defined(__SSE2__)
+	const __m128	scale = _mm_set1_ps(0.01f);
+	const __m128i	zero = _mm_setzero_si128();
+	__m128i		v;
+
+	for ( ; i + 8 <= n; i += 8 ) {
+		v = _mm_loadu_si128((const __m128i*)(ck + i));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), scale));
+	}
+#elif defined(TCAM_RADIO_NEON)
+	uint16x8_t	v;
+
+	for ( ; i + 8 <= n; i += 8 ) {
+		v = vld1q_u16(ck + i);
+		vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), 0.01f));
+		vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), 0.01f));
+	}
+#endif
+
+	for ( ; i < n; i++ )
+		out[i] = (float)ck[i] * 0.01f;
+}
+
+static void tcam_radio_select(void)
+{
+	void (*apply)(const uint16_t*, const uint16_t*, uint16_t*, size_t) = tcam_radio_apply_scalar;
+
+#ifdef TCAM_RADIO_X86
+	if ( __builtin_cpu_supports("avx2") )
+		apply = tcam_radio_apply_avx2;
+#endif
+
+	__atomic_store_n(&g_radio_apply, apply, __ATOMIC_RELEASE);
+}
+
+int tcam_radio_create(TCAM_RADIO_T** out, const TCAM_RADIO_CAL_T* cal)
+{
+	TCAM_RADIO_T*	radio;
+
+	*out = NULL;
+
+	if ( tcam_radio_check_cal(cal) )
+		return -EINVAL;
+
+	radio = aligned_alloc(64, (sizeof(*radio) + 63) & ~(size_t)63);
+	if ( NULL == radio )
+		return -ENOMEM;
+
+	memset(radio, 0, sizeof(*radio));
+	radio->cal = *cal;
+	tcam_radio_reset(radio);
+
+	if ( NULL == __atomic_load_n(&g_radio_apply, __ATOMIC_ACQUIRE) )
+		tcam_radio_select();
+
+	*out = radio;
+
+	return 0;
+}
+
+void tcam_radio_destroy(TCAM_RADIO_T* radio)
+{
+	free(radio);
+}
+
+int tcam_radio_set_cal(TCAM_RADIO_T* radio, const TCAM_RADIO_CAL_T* cal)
+{
+	if ( tcam_radio_check_cal(cal) )
+		return -EINVAL;
+
+	radio->cal = *cal;
+	tcam_radio_reset(radio);
+
+	return 0;
+}
+
+int tcam_radio_update(TCAM_RADIO_T* radio, uint16_t fpa_ck)
+{
+	const TCAM_RADIO_CAL_T*	cal = &radio->cal;
+	TCAM_RADIO_LUT_T*		lut;
+	int32_t		bucket = fpa_ck / cal->bucket_ck;
+	int32_t		center;
+	uint32_t	to;
+
+	if ( radio->active ) {
+		if ( bucket == radio->active->bucket )
+			return 0;
+
+		//	경계에서 왔다갔다 하지 않도록 1/4 bucket hysteresis
+		center = radio->active->bucket * cal->bucket_ck + cal->bucket_ck / 2;
+		if ( abs((int32_t)fpa_ck - center) <= cal->bucket_ck / 2 + cal->bucket_ck / 4 )
+			return 0;
+	}
+
+	lut = tcam_radio_cached(radio, bucket);
+	if ( lut ) {
+		tcam_radio_activate(radio, lut);
+		radio->building = NULL;
+		return 1;
+	}
+
+	if ( NULL == radio->building || bucket != radio->building->bucket ) {
+		radio->building			= tcam_radio_victim(radio);
+		radio->building->bucket	= bucket;
+		radio->building->built	= 0;
+	}
+
+	lut = radio->building;
+	to	= radio->active ? lut->built + TCAM_RADIO_BUILD_STEP : TCAM_RADIO_LUT_SIZE;
+	if ( to > TCAM_RADIO_LUT_SIZE )
+		to = TCAM_RADIO_LUT_SIZE;
+
+	tcam_radio_build(cal, lut, lut->built, to);
+
+	if ( TCAM_RADIO_LUT_SIZE != lut->built )
+		return 0;
+
+#ifdef TCAMLIB_DBG_MSG
+	fprintf(stderr, "tcam_radio: FPA %u cK, LUT bucket %d\n", fpa_ck, bucket);
+#endif
+
+	tcam_radio_activate(radio, lut);
+	radio->building = NULL;
+
+	return 1;
+}
+
+int tcam_radio_bucket(const TCAM_RADIO_T* radio)
+{
+	return radio->active ? radio->active->bucket : -1;
+}
+
+void tcam_radio_apply_ck(const TCAM_RADIO_T* radio, const uint16_t* counts, uint16_t* out, size_t n)
+{
+	if ( NULL == radio->active ) {
+		memset(out, 0, n * sizeof(*out));
+		return;
+	}
+
+	g_radio_apply(radio->active->ck, counts, out, n);
+}
+
+void tcam_radio_apply_k(const TCAM_RADIO_T* radio, const uint16_t* counts, float* out, size_t n)
+{
+	uint16_t	ck[TCAM_RADIO_CHUNK];
+	size_t		i, len;
+
+	if ( NULL == radio->active ) {
+		memset(out, 0, n * sizeof(*out));
+		return;
+	}
+
+	//	lookup 과 변환을 나눠서 둘 다 SIMD 로
+	for ( i = 0; i < n; i += len ) {
+		len = n - i < TCAM_RADIO_CHUNK ? n - i : TCAM_RADIO_CHUNK;
+
+		g_radio_apply(radio->active->ck, counts + i, ck, len);
+		tcam_radio_ck_to_k(ck, out + i, len);
+	}
+}
+
+uint16_t tcam_radio_count_to_ck(const TCAM_RADIO_T* radio, uint16_t count)
+{
+	return radio->active ? radio->active->ck[count & TCAM_RADIO_MASK] : 0;
+}
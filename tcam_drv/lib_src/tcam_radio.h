@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Radiometric conversion, 14 bit counts to temperature.
+ *
+ * Model (per unit calibration, FPA temperature compensated):
+ *
+ *   S   = R' / (exp(B / T) - F) + O'
+ *   R'  = R * (1 + r_per_k * dFPA),  O' = O + o_per_k * dFPA
+ *   dFPA = FPA temperature - fpa_ref
+ *
+ * corrected for emissivity against a reflected temperature. The model is
+ * evaluated once per count into a 16K entry centi-Kelvin LUT for each FPA
+ * temperature bucket, frames only do table lookups.
+ *
+ * Feed tcam_radio_update() the FPA temperature of every frame (telemetry
+ * line). When it drifts into another bucket the LUT for it is built a
+ * slice per call while the previous one stays in use, so no frame pays
+ * a full rebuild. Recently used buckets are cached.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_RADIO_H__
+#define __TCAM_RADIO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_RADIO_LUT_SIZE		(16384)		//	14 bit counts
+#define		TCAM_RADIO_CACHE		(4)			//	LUTs kept
+#define		TCAM_RADIO_BUILD_STEP	(2048)		//	entries per update() while drifting
+
+typedef struct __tcam_radio_cal__ {
+	double		planck_r;
+	double		planck_b;		//	K
+	double		planck_f;
+	double		planck_o;		//	counts at fpa_ref
+	double		r_per_k;		//	relative gain drift per K of FPA
+	double		o_per_k;		//	offset drift in counts per K of FPA
+	uint16_t	fpa_ref_ck;		//	0.01 K
+	uint16_t	bucket_ck;		//	FPA temperature step of one LUT, 0.01 K
+	double		emissivity;		//	0 < e <= 1
+	double		reflected_k;	//	background seen in the target, K
+} TCAM_RADIO_CAL_T;
+
+typedef struct __tcam_radio__ TCAM_RADIO_T;
+
+/* nominal values, replace with the calibration of the unit */
+void tcam_radio_default_cal(TCAM_RADIO_CAL_T* cal);
+
+int tcam_radio_create(TCAM_RADIO_T** radio, const TCAM_RADIO_CAL_T* cal);
+void tcam_radio_destroy(TCAM_RADIO_T* radio);
+
+/* drop every cached LUT, next update() builds synchronously. 0 or -EINVAL */
+int tcam_radio_set_cal(TCAM_RADIO_T* radio, const TCAM_RADIO_CAL_T* cal);
+
+/*
+ * FPA temperature of the current frame. Returns 1 when the active LUT
+ * changed, 0 otherwise. The first call builds the LUT synchronously.
+ */
+int tcam_radio_update(TCAM_RADIO_T* radio, uint16_t fpa_ck);
+
+/* FPA bucket the active LUT was built for, -1 before the first update() */
+int tcam_radio_bucket(const TCAM_RADIO_T* radio);
+
+/* n counts to 0.01 K, counts are masked to 14 bit */
+void tcam_radio_apply_ck(const TCAM_RADIO_T* radio, const uint16_t* counts, uint16_t* out, size_t n);
+
+/* n counts to K */
+void tcam_radio_apply_k(const TCAM_RADIO_T* radio, const uint16_t* counts, float* out, size_t n);
+
+/* spot value, 0.01 K */
+uint16_t tcam_radio_count_to_ck(const TCAM_RADIO_T* radio, uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_RADIO_H__ */
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Real-time capture support for the COX LWIR cameras.
+ *
+ * Busy polling at SCHED_FIFO owns the CPU it runs on, use it only on a
+ * core taken out of the scheduler with isolcpus= (and nohz_full=), and
+ * mind the RT throttling of sched_rt_runtime_us on that core.
+ *
+ * Copyright (C).
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "tcam_rt.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+#define		TCAM_RT_STACK_PREFAULT	(128 * 1024)
+#define		TCAM_RT_ISOLATED_PATH	"/sys/devices/system/cpu/isolated"
+
+
+static int tcam_hist_index(uint64_t value)
+{
+	int		e;
+
+	if ( value < TCAM_HIST_SUB_COUNT )
+		return (int)value;
+
+	//	value >> e 는 [SUB_HALF, SUB_COUNT) 범위
+	e = 63 - __builtin_clzll(value) - (TCAM_HIST_SUB_BITS - 1);
+
+	return TCAM_HIST_SUB_COUNT + (e - 1) * TCAM_HIST_SUB_HALF +
+		(int)(value >> e) - TCAM_HIST_SUB_HALF;
+}
+
+static uint64_t tcam_hist_lower(int idx)
+{
+	int		k, e;
+
+	if ( idx < TCAM_HIST_SUB_COUNT )
+		return (uint64_t)idx;
+
+	k = idx - TCAM_HIST_SUB_COUNT;
+	e = k / TCAM_HIST_SUB_HALF + 1;
+
+	return (uint64_t)(k % TCAM_HIST_SUB_HALF + TCAM_HIST_SUB_HALF) << e;
+}
+
+static void tcam_hist_snapshot(const TCAM_HIST_T* hist, TCAM_HIST_T* snap)
+{
+	int		i;
+
+	snap->count	= __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+	snap->sum	= __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+	snap->min	= __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+	snap->max	= __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+
+	for ( i = 0; i < TCAM_HIST_BUCKETS; i++ )
+		snap->buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+}
+
+static uint64_t tcam_hist_find(const TCAM_HIST_T* hist, uint64_t total, double pct)
+{
+	uint64_t	target, cum = 0;
+	int		i;
+
+	if ( 0 == total )
+		return 0;
+
+	target = (uint64_t)(pct / 100.0 * (double)total + 0.5);
+	if ( target < 1 )
+		target = 1;
+	if ( target > total )
+		target = total;
+
+	for ( i = 0; i < TCAM_HIST_BUCKETS; i++ ) {
+		cum += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+		if ( cum >= target )
+			return tcam_hist_lower(i);
+	}
+
+	return tcam_hist_lower(TCAM_HIST_BUCKETS - 1);
+}
+
+void tcam_hist_reset(TCAM_HIST_T* hist)
+{
+	memset(hist, 0, sizeof(*hist));
+	hist->min = UINT64_MAX;
+}
+
+void tcam_hist_record(TCAM_HIST_T* hist, uint64_t value)
+{
+	uint64_t	cur;
+
+	__atomic_fetch_add(&hist->buckets[tcam_hist_index(value)], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+
+	cur = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+	while ( value < cur &&
+		!__atomic_compare_exchange_n(&hist->min, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+		;
+
+	cur = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	while ( value > cur &&
+		!__atomic_compare_exchange_n(&hist->max, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+		;
+
+	//	count 는 마지막에 올려서 reader 가 bucket 합보다 큰 count 를 보지 않게 한다
+	__atomic_fetch_add(&hist->count, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t tcam_hist_percentile(const TCAM_HIST_T* hist, double pct)
+{
+	return tcam_hist_find(hist, __atomic_load_n(&hist->count, __ATOMIC_ACQUIRE), pct);
+}
+
+void tcam_hist_dump(const TCAM_HIST_T* hist, FILE* fp)
+{
+	static const double	pcts[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+	TCAM_HIST_T*	snap;
+	uint64_t		total = 0, cum = 0;
+	size_t			i;
+
+	snap = malloc(sizeof(*snap));
+	if ( NULL == snap )
+		return;
+
+	tcam_hist_snapshot(hist, snap);
+
+	for ( i = 0; i < TCAM_HIST_BUCKETS; i++ )
+		total += snap->buckets[i];
+
+	if ( 0 == total ) {
+		fprintf(fp, "latency: no samples\n");
+		free(snap);
+		return;
+	}
+
+	fprintf(fp, "latency: count %llu min %.1f mean %.1f max %.1f us\n",
+		(unsigned long long)total, snap->min / 1000.0,
+		(double)snap->sum / (double)total / 1000.0, snap->max / 1000.0);
+
+	fprintf(fp, " ");
+	for ( i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++ )
+		fprintf(fp, " p%g %.1f", pcts[i], tcam_hist_find(snap, total, pcts[i]) / 1000.0);
+	fprintf(fp, " us\n");
+
+	fprintf(fp, "  %12s %12s %8s\n", ">= us", "count", "cum %");
+	for ( i = 0; i < TCAM_HIST_BUCKETS; i++ ) {
+		if ( 0 == snap->buckets[i] )
+			continue;
+
+		cum += snap->buckets[i];
+		fprintf(fp, "  %12.3f %12llu %8.3f\n", tcam_hist_lower((int)i) / 1000.0,
+			(unsigned long long)snap->buckets[i], 100.0 * (double)cum / (double)total);
+	}
+	fflush(fp);
+
+	free(snap);
+}
+
+uint64_t tcam_rt_latency_ns(const TCAM_FRAME_T* frame)
+{
+	struct timespec	ts;
+	uint64_t		now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+	//	timestamp 가 없는 (0) 버퍼나 다른 clock 은 0 으로 기록
+	if ( 0 == frame->timestamp_ns || frame->timestamp_ns > now )
+		return 0;
+
+	return now - frame->timestamp_ns;
+}
+
+int tcam_rt_cpu_isolated(int cpu)
+{
+	FILE*	fp;
+	char	buf[256];
+	char*	tok;
+	char*	save;
+	int		lo, hi, n, found = 0;
+
+	fp = fopen(TCAM_RT_ISOLATED_PATH, "r");
+	if ( NULL == fp )
+		return 0;
+
+	if ( NULL == fgets(buf, sizeof(buf), fp) )
+		buf[0] = '\0';
+	fclose(fp);
+
+	//	"2-3,5" 형식
+	for ( tok = strtok_r(buf, ",\n", &save); tok && !found; tok = strtok_r(NULL, ",\n", &save) ) {
+		n = sscanf(tok, "%d-%d", &lo, &hi);
+		if ( 1 == n )
+			hi = lo;
+		if ( n >= 1 && cpu >= lo && cpu <= hi )
+			found = 1;
+	}
+
+	return found;
+}
+
+static void __attribute__((noinline)) tcam_rt_prefault_stack(void)
+{
+	volatile uint8_t	stack[TCAM_RT_STACK_PREFAULT];
+	size_t	i;
+
+	for ( i = 0; i < sizeof(stack); i += 4096 )
+		stack[i] = 0;
+}
+
+int tcam_rt_apply(const TCAM_RT_CFG_T* cfg)
+{
+	struct sched_param	sp;
+	cpu_set_t	set;
+	int		ret;
+
+	if ( cfg->lock_memory ) {
+		if ( mlockall(MCL_CURRENT | MCL_FUTURE) < 0 )
+			return -errno;
+
+		//	free() 가 heap 을 OS 로 돌려주면 다음 malloc 에서 page fault
+		mallopt(M_TRIM_THRESHOLD, -1);
+		mallopt(M_MMAP_MAX, 0);
+
+		tcam_rt_prefault_stack();
+	}
+
+	if ( cfg->cpu >= 0 ) {
+		CPU_ZERO(&set);
+		CPU_SET(cfg->cpu, &set);
+
+		ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if ( ret )
+			return -ret;
+
+		if ( !tcam_rt_cpu_isolated(cfg->cpu) )
+			fprintf(stderr, "tcam_rt: cpu %d is not isolated, add isolcpus=%d\n", cfg->cpu, cfg->cpu);
+	}
+
+	if ( cfg->priority > 0 ) {
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = cfg->priority;
+
+		ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+		if ( ret )
+			return -ret;
+	}
+
+#ifdef TCAMLIB_DBG_MSG
+	fprintf(stderr, "tcam_rt: cpu %d prio %d mlock %d busy %d\n",
+		cfg->cpu, cfg->priority, cfg->lock_memory, cfg->busy_poll);
+#endif
+
+	return 0;
+}
+
+int tcam_rt_run(TCAM_LOOP_T* loop, const TCAM_RT_CFG_T* cfg)
+{
+	int		ret;
+
+	ret = tcam_rt_apply(cfg);
+	if ( ret )
+		return ret;
+
+	return tcam_loop_run_poll(loop, cfg->busy_poll ? 0 : -1);
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Real-time capture support: SCHED_FIFO, CPU pinning, locked memory and
+ * an HDR-style latency histogram.
+ *
+ * The histogram is log-linear: exact below 128 ns, then 64 sub-buckets
+ * per power of two (about 1.6 % resolution) up to 2^64 ns. Recording is
+ * a single relaxed atomic increment; the histogram can be read or dumped
+ * from another thread while the RT thread records into it.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_RT_H__
+#define __TCAM_RT_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tcam_capture.h"
+#include "tcam_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_HIST_SUB_BITS		(7)
+#define		TCAM_HIST_SUB_COUNT		(1 << TCAM_HIST_SUB_BITS)
+#define		TCAM_HIST_SUB_HALF		(TCAM_HIST_SUB_COUNT / 2)
+#define		TCAM_HIST_BUCKETS		(TCAM_HIST_SUB_COUNT + (64 - TCAM_HIST_SUB_BITS) * TCAM_HIST_SUB_HALF)
+
+typedef struct __tcam_hist__ {
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	min;
+	uint64_t	max;
+	uint64_t	buckets[TCAM_HIST_BUCKETS];
+} TCAM_HIST_T;
+
+void tcam_hist_reset(TCAM_HIST_T* hist);
+void tcam_hist_record(TCAM_HIST_T* hist, uint64_t value);
+
+/* lower bound of the bucket holding the pct (0..100) percentile */
+uint64_t tcam_hist_percentile(const TCAM_HIST_T* hist, double pct);
+
+/* summary, percentiles and non-empty buckets, values in us */
+void tcam_hist_dump(const TCAM_HIST_T* hist, FILE* fp);
+
+/* V4L2 buffer timestamp (CLOCK_MONOTONIC) to now, in ns */
+uint64_t tcam_rt_latency_ns(const TCAM_FRAME_T* frame);
+
+typedef struct __tcam_rt_cfg__ {
+	int			cpu;			//	pin to this CPU, -1 leaves affinity
+	int			priority;		//	SCHED_FIFO 1..99, 0 leaves the policy
+	int			lock_memory;	//	mlockall and prefault the stack
+	int			busy_poll;		//	never sleep in the loop
+} TCAM_RT_CFG_T;
+
+/* 1 when cpu is listed in /sys/devices/system/cpu/isolated */
+int tcam_rt_cpu_isolated(int cpu);
+
+/* apply cfg to the calling thread, 0 or -errno */
+int tcam_rt_apply(const TCAM_RT_CFG_T* cfg);
+
+/* tcam_rt_apply() then run loop until tcam_loop_stop(), 0 or -errno */
+int tcam_rt_run(TCAM_LOOP_T* loop, const TCAM_RT_CFG_T* cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_RT_H__ */
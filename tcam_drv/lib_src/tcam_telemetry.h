@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Zero-copy view of the tcam-raw telemetry line.
+ *
+ * The FPGA appends one line after the image, a run of big endian 16 bit
+ * words. Word 0 is the layout version, later versions only append words,
+ * so a field keeps its offset once defined.
+ *
+ *   const uint8_t*		line;
+ *   TCAM_TELEMETRY_T	tlm;
+ *
+ *   tcam_unpack_frame(frame, plane, &line);
+ *   if ( 0 == tcam_telemetry_view(&tlm, line, TCAM_RAW_TELEMETRY_LEN) )
+ *       fpa_ck = tcam_tlm_fpa_ck(&tlm);
+ *
+ * Everything is inline with constant offsets, an accessor is one load
+ * and a byte swap straight out of the capture buffer.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_TELEMETRY_H__
+#define __TCAM_TELEMETRY_H__
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_TELEMETRY_V1		(1)
+#define		TCAM_TELEMETRY_VER_MAX	TCAM_TELEMETRY_V1
+
+#define		TCAM_TLM_KELVIN_0C		(27315)		//	0 'C in 0.01 K
+
+//	word index in the line
+typedef enum __tcam_tlm_field__ {
+	TCAM_TLM_VERSION = 0,
+	TCAM_TLM_FRAME_COUNT,		//	wraps at 16 bit
+	TCAM_TLM_FPA_TEMP,			//	0.01 K
+	TCAM_TLM_FPGA_TEMP,			//	0.01 K
+	TCAM_TLM_FFC_COUNT,
+	TCAM_TLM_INT_TIME,			//	us
+	TCAM_TLM_PIX_MAX,			//	hottest count of the frame
+	TCAM_TLM_PIX_MIN,			//	coldest count of the frame
+	TCAM_TLM_V1_FIELDS,
+} eTCAM_TLM_FIELD;
+
+typedef struct __tcam_telemetry__ {
+	const uint8_t*	line;
+	uint16_t		version;
+	uint16_t		fields;			//	words defined by version
+} TCAM_TELEMETRY_T;
+
+//	endianness 는 여기서만 처리한다
+static inline uint16_t tcam_tlm_be16(const uint8_t* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint16_t tcam_tlm_fields_of(uint16_t version)
+{
+	switch ( version ) {
+	case TCAM_TELEMETRY_V1:	return TCAM_TLM_V1_FIELDS;
+	default:				return 0;
+	}
+}
+
+/*
+ * 0, -EINVAL when line is shorter than the fields of its version or
+ * -EPROTONOSUPPORT for a version newer than this header
+ */
+static inline int tcam_telemetry_view(TCAM_TELEMETRY_T* tlm, const uint8_t* line, size_t len)
+{
+	if ( NULL == line || len < 2 )
+		return -EINVAL;
+
+	tlm->line		= line;
+	tlm->version	= tcam_tlm_be16(line);
+	tlm->fields		= tcam_tlm_fields_of(tlm->version);
+
+	if ( 0 == tlm->fields )
+		return -EPROTONOSUPPORT;
+	if ( len < (size_t)tlm->fields * 2 )
+		return -EINVAL;
+
+	return 0;
+}
+
+static inline int tcam_tlm_has(const TCAM_TELEMETRY_T* tlm, eTCAM_TLM_FIELD field)
+{
+	return field < tlm->fields;
+}
+
+/* raw word, the caller checked the view (and tcam_tlm_has() for newer fields) */
+static inline uint16_t tcam_tlm_word(const TCAM_TELEMETRY_T* tlm, eTCAM_TLM_FIELD field)
+{
+	return tcam_tlm_be16(tlm->line + 2 * field);
+}
+
+static inline uint16_t tcam_tlm_frame_count(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_FRAME_COUNT);
+}
+
+static inline uint16_t tcam_tlm_fpa_ck(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_FPA_TEMP);
+}
+
+static inline uint16_t tcam_tlm_fpga_ck(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_FPGA_TEMP);
+}
+
+static inline uint16_t tcam_tlm_ffc_count(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_FFC_COUNT);
+}
+
+static inline uint16_t tcam_tlm_int_time_us(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_INT_TIME);
+}
+
+static inline uint16_t tcam_tlm_pix_max(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_PIX_MAX);
+}
+
+static inline uint16_t tcam_tlm_pix_min(const TCAM_TELEMETRY_T* tlm)
+{
+	return tcam_tlm_word(tlm, TCAM_TLM_PIX_MIN);
+}
+
+/* 0.01 K to 'C */
+static inline float tcam_tlm_ck_to_c(uint16_t ck)
+{
+	return (float)((int)ck - TCAM_TLM_KELVIN_0C) / 100.0f;
+}
+
+/* frames since prev across the 16 bit wrap, > 1 means frames were lost */
+static inline uint16_t tcam_tlm_frame_delta(uint16_t prev, uint16_t cur)
+{
+	return (uint16_t)(cur - prev);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_TELEMETRY_H__ */
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * tcam-raw frame unpacker, see tcam_unpack.h.
+ *
+ * Swapping and masking is a couple of ALU ops per 16 bytes, so every
+ * kernel is bound by the load / store stream. 384x288 counts are 216 KiB
+ * out, which stays in L2 for the next stage, hence plain (not streaming)
+ * stores.
+ *
+ * Copyright (C).
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define		TCAM_UNPACK_X86
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define		TCAM_UNPACK_NEON
+#endif
+
+#include <linux/videodev2.h>
+
+#include "tcam_unpack.h"
+
+
+//#define		TCAMLIB_DBG_MSG
+
+typedef void (*TCAM_UNPACK_LINE)(uint16_t* dst, const uint8_t* src, uint32_t width);
+
+typedef struct __tcam_unpack_kernel__ {
+	const char*			name;
+	TCAM_UNPACK_LINE	line;
+	int					(*supported)(void);
+} TCAM_UNPACK_KERNEL_T;
+
+static const TCAM_UNPACK_KERNEL_T*	g_unpack;
+
+
+static void tcam_unpack_line_scalar(uint16_t* dst, const uint8_t* src, uint32_t width)
+{
+	uint32_t	x;
+
+	for ( x = 0; x < width; x++ )
+		dst[x] = (uint16_t)((src[2 * x] << 8) | src[2 * x + 1]) & TCAM_RAW_MASK;
+}
+
+static int tcam_unpack_always(void)
+{
+	return 1;
+}
+
+#ifdef TCAM_UNPACK_X86
+static void tcam_unpack_line_sse2(uint16_t* dst, const uint8_t* src, uint32_t width)
+{
+	const __m128i	mask = _mm_set1_epi16(TCAM_RAW_MASK);
+	__m128i		a, b;
+	uint32_t	x = 0;
+
+	for ( ; x + 16 <= width; x += 16 ) {
+		a = _mm_loadu_si128((const __m128i*)(src + 2 * x));
+		b = _mm_loadu_si128((const __m128i*)(src + 2 * x + 16));
+
+		a = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8)), mask);
+		b = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8)), mask);
+
+		_mm_storeu_si128((__m128i*)(dst + x), a);
+		_mm_storeu_si128((__m128i*)(dst + x + 8), b);
+	}
+
+	tcam_unpack_line_scalar(dst + x, src + 2 * x, width - x);
+}
+
+static int tcam_unpack_has_sse2(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+__attribute__((target("avx2")))
+static void tcam_unpack_line_avx2(uint16_t* dst, const uint8_t* src, uint32_t width)
+{
+	const __m256i	mask = _mm256_set1_epi16(TCAM_RAW_MASK);
+	const __m256i	swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+						1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	__m256i		a, b;
+	uint32_t	x = 0;
+
+	for ( ; x + 32 <= width; x += 32 ) {
+		a = _mm256_loadu_si256((const __m256i*)(src + 2 * x));
+		b = _mm256_loadu_si256((const __m256i*)(src + 2 * x + 32));
+
+		a = _mm256_and_si256(_mm256_shuffle_epi8(a, swap), mask);
+		b = _mm256_and_si256(_mm256_shuffle_epi8(b, swap), mask);
+
+		_mm256_storeu_si256((__m256i*)(dst + x), a);
+		_mm256_storeu_si256((__m256i*)(dst + x + 16), b);
+	}
+
+	tcam_unpack_line_sse2(dst + x, src + 2 * x, width - x);
+}
+
+static int tcam_unpack_has_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#ifdef TCAM_UNPACK_NEON
+static void tcam_unpack_line_neon(uint16_t* dst, const uint8_t* src, uint32_t width)
+{
+	const uint16x8_t	mask = vdupq_n_u16(TCAM_RAW_MASK);
+	uint8x16_t			a, b;
+	uint32_t	x = 0;
+
+	for ( ; x + 16 <= width; x += 16 ) {
+		a = vld1q_u8(src + 2 * x);
+		b = vld1q_u8(src + 2 * x + 16);
+
+		vst1q_u16(dst + x, vandq_u16(vreinterpretq_u16_u8(vrev16q_u8(a)), mask));
+		vst1q_u16(dst + x + 8, vandq_u16(vreinterpretq_u16_u8(vrev16q_u8(b)), mask));
+	}
+
+	tcam_unpack_line_scalar(dst + x, src + 2 * x, width - x);
+}
+#endif
+
+//	선호 순서
+static const TCAM_UNPACK_KERNEL_T	g_unpack_kernels[] = {
+#ifdef TCAM_UNPACK_NEON
+	{ "neon",	tcam_unpack_line_neon,		tcam_unpack_always },
+#endif
+#ifdef TCAM_UNPACK_X86
+	{ "avx2",	tcam_unpack_line_avx2,		tcam_unpack_has_avx2 },
+	{ "sse2",	tcam_unpack_line_sse2,		tcam_unpack_has_sse2 },
+#endif
+	{ "scalar",	tcam_unpack_line_scalar,	tcam_unpack_always },
+};
+
+#define		NUM_UNPACK_KERNELS	(sizeof(g_unpack_kernels) / sizeof(g_unpack_kernels[0]))
+
+static const TCAM_UNPACK_KERNEL_T* tcam_unpack_select(void)
+{
+	const TCAM_UNPACK_KERNEL_T*	k = __atomic_load_n(&g_unpack, __ATOMIC_ACQUIRE);
+	const char*	force;
+	size_t		i;
+
+	if ( k )
+		return k;
+
+	force = getenv("TCAM_UNPACK");
+
+	//	선택은 항상 같은 결과라서 여러 thread 가 동시에 해도 된다
+	for ( i = 0; i < NUM_UNPACK_KERNELS && NULL == k; i++ ) {
+		if ( force && strcmp(force, g_unpack_kernels[i].name) )
+			continue;
+		if ( g_unpack_kernels[i].supported() )
+			k = &g_unpack_kernels[i];
+	}
+
+	if ( NULL == k )
+		k = &g_unpack_kernels[NUM_UNPACK_KERNELS - 1];
+
+	__atomic_store_n(&g_unpack, k, __ATOMIC_RELEASE);
+
+	return k;
+}
+
+void tcam_unpack_lines(uint16_t* dst, size_t dst_stride, const uint8_t* src, size_t src_stride,
+		       uint32_t width, uint32_t height)
+{
+	TCAM_UNPACK_LINE	line = tcam_unpack_select()->line;
+	uint32_t	y;
+
+	//	stride 가 딱 맞으면 한 줄로 처리해서 line 끝 tail 을 없앤다
+	if ( dst_stride == width && src_stride == (size_t)width * 2 ) {
+		line(dst, src, width * height);
+		return;
+	}
+
+	for ( y = 0; y < height; y++ )
+		line(dst + y * dst_stride, src + y * src_stride, width);
+}
+
+int tcam_unpack_frame(const TCAM_FRAME_T* frame, uint16_t* dst, const uint8_t** telemetry)
+{
+	uint32_t	height;
+
+	if ( V4L2_PIX_FMT_UYVY != frame->pixelformat || frame->height < 2 ||
+	     frame->stride < frame->width * 2 ||
+	     frame->bytesused < frame->stride * (frame->height - 1) + frame->width * 2 )
+		return -EINVAL;
+
+	height = frame->height - 1;
+
+	tcam_unpack_lines(dst, frame->width, frame->data, frame->stride, frame->width, height);
+
+	if ( telemetry )
+		*telemetry = frame->data + (size_t)height * frame->stride;
+
+#ifdef TCAMLIB_DBG_MSG
+	fprintf(stderr, "tcam_unpack: %ux%u stride %u (%s)\n",
+		frame->width, height, frame->stride, tcam_unpack_select()->name);
+#endif
+
+	return 0;
+}
+
+const char* tcam_unpack_isa(void)
+{
+	return tcam_unpack_select()->name;
+}
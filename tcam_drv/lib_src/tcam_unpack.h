@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * tcam-raw frame unpacker.
+ *
+ * tcam-raw sends 384x289 UYVY8_1X16: every "pixel" is one 14 bit count,
+ * MSB first, and the last line is FPGA telemetry. The unpacker turns the
+ * 384x288 image part of a captured buffer (stride padded by CFE) into a
+ * contiguous host endian uint16 plane and hands out the telemetry line
+ * in place.
+ *
+ * The kernel is picked once at runtime: NEON on arm64, AVX2 or SSE2 on
+ * x86_64, scalar otherwise. TCAM_UNPACK=scalar|sse2|avx2|neon in the
+ * environment forces one for comparisons.
+ *
+ * Copyright (C).
+ */
+
+#ifndef __TCAM_UNPACK_H__
+#define __TCAM_UNPACK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tcam_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define		TCAM_RAW_WIDTH			(384)
+#define		TCAM_RAW_HEIGHT			(288)		//	image lines
+#define		TCAM_RAW_LINES			(TCAM_RAW_HEIGHT + 1)
+#define		TCAM_RAW_MASK			(0x3fff)	//	14 bit ADC
+#define		TCAM_RAW_TELEMETRY_LEN	(TCAM_RAW_WIDTH * 2)
+
+/*
+ * width x height counts from src (src_stride bytes per line) to dst
+ * (dst_stride elements per line), byte swapped and masked to 14 bit
+ */
+void tcam_unpack_lines(uint16_t* dst, size_t dst_stride, const uint8_t* src, size_t src_stride,
+		       uint32_t width, uint32_t height);
+
+/*
+ * a tcam-raw frame into dst (width * (height - 1) elements, contiguous).
+ * telemetry, when not NULL, points at the last line inside the frame and
+ * is valid as long as the frame. 0 or -EINVAL on a non raw frame
+ */
+int tcam_unpack_frame(const TCAM_FRAME_T* frame, uint16_t* dst, const uint8_t** telemetry);
+
+/* name of the selected kernel: "neon", "avx2", "sse2" or "scalar" */
+const char* tcam_unpack_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __TCAM_UNPACK_H__ */